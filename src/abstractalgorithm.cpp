@@ -1,7 +1,23 @@
 #include "abstractalgorithm.h"
 
-AbstractAlgorithm::AbstractAlgorithm(CImg<> input, unsigned int nbIteration, bool prematureStop, unsigned int windowSize, double gapPercentage, bool verbose, bool produceStats)
-    : m_verbose(verbose)
+#include <numeric>
+
+AbstractAlgorithm::AbstractAlgorithm(CImg<> input, unsigned int nbIteration, bool prematureStop, unsigned int windowSize, double gapPercentage, bool verbose, bool produceStats, unsigned int seed)
+    : m_sweepMode(SweepMode::GAUSS_SEIDEL)
+    , m_nbThreads(1)
+    , m_threadPool()
+    , m_previousImage()
+    , m_patchRadius(1)
+    , m_dirtyScheduling(false)
+    , m_dirtyEnergy(0)
+    , m_nbCandidates(0)
+    , m_nbPruned(0)
+    , m_nbChanged(0)
+    , m_iterations()
+    , m_telemetry()
+    , m_telemetryRun(0)
+    , m_telemetryTime(0)
+    , m_verbose(verbose)
     , m_fileStats(produceStats)
     , m_nbIterations(nbIteration)
     , m_enablePrematureStop(prematureStop)
@@ -9,9 +25,49 @@ AbstractAlgorithm::AbstractAlgorithm(CImg<> input, unsigned int nbIteration, boo
     , m_gapPercentage(gapPercentage)
     , m_lastMedian(std::numeric_limits<double>::max())
     , m_lastEnergies()
+    , m_energyMedian()
     , m_image(input)
+    , m_inMask(input.width(), input.height(), input.depth(), 1, false)
+    , m_seed(seed)
+    , m_random(seed)
+{
+    // Mask pixels are 255 in every channel
+    cimg_forXYZ(m_image, x, y, z)
+    {
+        bool inMask = true;
+        cimg_forC(m_image, c)
+            inMask = inMask && m_image(x, y, z, c) == 255;
+        m_inMask(x, y, z) = inMask;
+    }
+}
+
+void AbstractAlgorithm::initialize(const CImg<>& guess)
 {
+    cimg_forXYZ(m_image, x, y, z)
+    {
+        if (m_inMask(x, y, z))
+        {
+            cimg_forC(m_image, c)
+                m_image(x, y, z, c) = guess(x, y, z, c);
+        }
+    }
+
+    // Every pixel has to be searched again, the initialization is not counted as changes
+    m_dirty.clear();
+    m_nbChanged = 0;
+}
+
+void AbstractAlgorithm::setTelemetry(std::shared_ptr<TelemetrySink> sink)
+{
+    m_telemetry = sink;
+    if (m_telemetry)
+    {
+        m_telemetryRun = m_telemetry->newRun();
+        m_telemetryTime = m_telemetry->now();
+    }
 
+    // Pixels written by the initialization are not counted as changes
+    m_nbChanged = 0;
 }
 
 bool AbstractAlgorithm::computePrematureStop(double energy)
@@ -19,22 +75,327 @@ bool AbstractAlgorithm::computePrematureStop(double energy)
     bool ret = false;
 
     m_lastEnergies.push_back(energy);
+    m_energyMedian.insert(energy);
     if (m_lastEnergies.size() >= m_movableWindowSize)
     {
-        const unsigned int index = std::ceil(m_lastEnergies.size() / 2.0);
-        std::vector<double> sortedEnergies(m_lastEnergies.begin(), m_lastEnergies.end());
-        //std::sort(sortedEnergies.begin(), sortedEnergies.end());
-        std::partial_sort(sortedEnergies.begin(), sortedEnergies.begin() + index, sortedEnergies.end());
         const double gap = m_gapPercentage * m_lastMedian;
         if (m_lastMedian - gap <= energy && m_lastMedian + gap >= energy)
         {
             ret = true;
         }
 
-        m_lastMedian = sortedEnergies[index - 1];
+        m_lastMedian = m_energyMedian.median();
 
+        m_energyMedian.erase(m_lastEnergies.front());
         m_lastEnergies.pop_front();
     }
 
     return ret;
 }
+
+ThreadPool& AbstractAlgorithm::threadPool()
+{
+    if (!m_threadPool)
+        m_threadPool.reset(new ThreadPool(m_nbThreads));
+
+    return *m_threadPool;
+}
+
+const CImg<>& AbstractAlgorithm::freezeImage()
+{
+    m_previousImage = m_image;
+    return m_previousImage;
+}
+
+void AbstractAlgorithm::commitPixels(const std::vector<std::size_t>& pixels)
+{
+    const unsigned int planeSize = m_image.width() * m_image.height() * m_image.depth();
+    for (std::size_t n : pixels)
+    {
+        cimg_forC(m_image, c)
+            m_previousImage[m_pixelOffsets[n] + c * planeSize] = m_image[m_pixelOffsets[n] + c * planeSize];
+    }
+}
+
+void AbstractAlgorithm::setPixelColor(std::size_t n, unsigned int x, unsigned int y, unsigned int z)
+{
+    // Pixels of a color are radius + 1 pixels apart in every direction
+    const unsigned int period = m_patchRadius + 1;
+    const unsigned int color = (x % period) + period * (y % period) + period * period * (z % period);
+    if (m_colors.size() <= color)
+        m_colors.resize(color + 1);
+
+    m_colors[color].push_back(n);
+
+    if (m_pixelOffsets.size() <= n)
+    {
+        m_pixelOffsets.resize(n + 1);
+        m_pixelColors.resize(n + 1);
+    }
+    m_pixelOffsets[n] = m_image.offset(x, y, z);
+    m_pixelColors[n] = color;
+}
+
+double AbstractAlgorithm::sweep(std::size_t count, const UpdateFunction& update, const unsigned int* matches)
+{
+    if (m_dirtyScheduling && m_pixelOffsets.size() == count)
+        return sweepDirty(count, matches, update);
+
+    return sweepAll(count, nullptr, update);
+}
+
+double AbstractAlgorithm::sweepDirty(std::size_t count, const unsigned int* matches, const UpdateFunction& update)
+{
+    // First scheduled sweep: every pixel is dirty
+    if (m_dirty.size() != count)
+    {
+        m_pixelIndices.assign(m_image.width(), m_image.height(), m_image.depth(), 1, -1);
+        for (std::size_t n = 0 ; n < count ; ++n)
+            m_pixelIndices[m_pixelOffsets[n]] = n;
+
+        m_dirty.assign(count, 1);
+        m_worklist.resize(count);
+        std::iota(m_worklist.begin(), m_worklist.end(), 0);
+        m_changed.assign(count, 0);
+        m_distances.assign(count, 0);
+        m_dirtyEnergy = 0;
+
+        m_matchHeads.assign(m_image.width(), m_image.height(), m_image.depth(), 1, -1);
+        m_matchNext.assign(count, -1);
+        m_matchPrevious.assign(count, -1);
+        m_listedMatches.assign(count, std::numeric_limits<unsigned int>::max());
+    }
+
+    const unsigned int nbChannels = std::min<unsigned int>(m_image.spectrum(), PatchDistanceBase::MaxChannels);
+    const unsigned int planeSize = m_image.width() * m_image.height() * m_image.depth();
+
+    // Flags of a pixel are only written by the task updating it, so that the update can run in parallel. The sweep
+    // sums the changes of the distances, clean pixels keeping theirs
+    m_dirtyEnergy += sweepAll(m_worklist.size(), m_worklist.data(), [&](std::size_t n, const CImg<>& source, const CImg<>& candidates)
+    {
+        // A pixel changed if any of its channels did
+        const unsigned int offset = m_pixelOffsets[n];
+        float values[PatchDistanceBase::MaxChannels];
+        for (unsigned int c = 0 ; c < nbChannels ; ++c)
+            values[c] = m_image[offset + c * planeSize];
+
+        const double previous = m_distances[n];
+        m_distances[n] = update(n, source, candidates);
+
+        bool changed = false;
+        for (unsigned int c = 0 ; c < nbChannels ; ++c)
+            changed = changed || m_image[offset + c * planeSize] != values[c];
+        m_changed[n] = changed;
+
+        return m_distances[n] - previous;
+    });
+
+    // Pixels are listed under their new match before the changes are propagated
+    for (std::size_t n : m_worklist)
+    {
+        m_dirty[n] = 0;
+        if (matches && matches[n] != m_listedMatches[n])
+            listMatch(n, matches[n]);
+    }
+
+    // The pixels around a changed pixel and the pixels whose match neighborhood covers it are searched by the next
+    // sweep
+    std::vector<std::size_t> worklist;
+    const auto markDirty = [&](int neighbor)
+    {
+        if (neighbor >= 0 && !m_dirty[neighbor])
+        {
+            m_dirty[neighbor] = 1;
+            worklist.push_back(neighbor);
+        }
+    };
+
+    const int r = int(m_patchRadius);
+    const int rz = m_image.depth() > 1 ? r : 0;
+    for (std::size_t n : m_worklist)
+    {
+        if (!m_changed[n])
+            continue;
+
+        m_changed[n] = 0;
+        const int x = m_pixelOffsets[n] % m_image.width();
+        const int y = (m_pixelOffsets[n] / m_image.width()) % m_image.height();
+        const int z = m_pixelOffsets[n] / (m_image.width() * m_image.height());
+        for (int dz = -rz ; dz <= rz ; ++dz)
+        {
+            for (int dy = -r ; dy <= r ; ++dy)
+            {
+                for (int dx = -r ; dx <= r ; ++dx)
+                {
+                    markDirty(m_pixelIndices.atXYZ(x + dx, y + dy, z + dz, 0, -1));
+                    for (int matched = m_matchHeads.atXYZ(x - dx, y - dy, z - dz, 0, -1) ; matched >= 0 ; matched = m_matchNext[matched])
+                        markDirty(matched);
+                }
+            }
+        }
+    }
+
+    // Gauss-Seidel sweeps update the dirty pixels in mask order
+    std::sort(worklist.begin(), worklist.end());
+    m_worklist.swap(worklist);
+
+    return m_dirtyEnergy;
+}
+
+void AbstractAlgorithm::listMatch(std::size_t n, unsigned int match)
+{
+    // Unlink the pixel from the list of its previous match
+    if (m_listedMatches[n] != std::numeric_limits<unsigned int>::max())
+    {
+        if (m_matchPrevious[n] >= 0)
+            m_matchNext[m_matchPrevious[n]] = m_matchNext[n];
+        else
+            m_matchHeads[m_listedMatches[n]] = m_matchNext[n];
+
+        if (m_matchNext[n] >= 0)
+            m_matchPrevious[m_matchNext[n]] = m_matchPrevious[n];
+    }
+
+    m_matchPrevious[n] = -1;
+    m_matchNext[n] = m_matchHeads[match];
+    if (m_matchNext[n] >= 0)
+        m_matchPrevious[m_matchNext[n]] = n;
+    m_matchHeads[match] = n;
+    m_listedMatches[n] = match;
+}
+
+double AbstractAlgorithm::sweepAll(std::size_t count, const std::size_t* order, const UpdateFunction& update)
+{
+    switch (m_sweepMode)
+    {
+    case SweepMode::JACOBI:
+        // Every pixel reads the previous iteration, so pixels can be updated concurrently
+        return parallelSweep(count, order, freezeImage(), update);
+
+    case SweepMode::COLORED:
+        if (!m_colors.empty())
+        {
+            // A partial sweep updates its pixels color by color too
+            std::vector< std::vector<std::size_t> > subset;
+            if (order)
+            {
+                subset.resize(m_colors.size());
+                for (std::size_t i = 0 ; i < count ; ++i)
+                    subset[m_pixelColors[order[i]]].push_back(order[i]);
+            }
+
+            // Pixels of a color never read each other, but the neighborhoods of their candidates may cover pixels of
+            // the color: every pixel reads the image as it was before its color, which is updated color by color
+            const CImg<>& source = freezeImage();
+            double energy = 0;
+            for (const auto& color : order ? subset : m_colors)
+            {
+                energy += parallelSweep(color.size(), color.data(), source, update);
+                commitPixels(color);
+            }
+
+            return energy;
+        }
+        // Colored sweep not supported by the algorithm: fall back to Gauss-Seidel
+
+    case SweepMode::SLABS:
+        if (m_sweepMode == SweepMode::SLABS && (order || m_pixelOffsets.size() == count))
+            return sweepSlabs(count, order, update);
+        // Slab sweep not supported by the algorithm: fall back to Gauss-Seidel
+
+    default:
+        double energy = 0;
+        for (std::size_t i = 0 ; i < count ; ++i)
+            energy += update(order ? order[i] : i, m_image, m_image);
+
+        return energy;
+    }
+}
+
+double AbstractAlgorithm::sweepSlabs(std::size_t count, const std::size_t* order, const UpdateFunction& update)
+{
+    // Slabs are layers of slices on volumes, of rows on images
+    const unsigned int sliceSize = m_image.depth() > 1 ? m_image.width() * m_image.height() : m_image.width();
+    const unsigned int thickness = std::max(SlabThickness, m_patchRadius);
+    if (m_slabs.empty())
+    {
+        for (std::size_t n = 0 ; n < m_pixelOffsets.size() ; ++n)
+        {
+            const std::size_t slab = m_pixelOffsets[n] / sliceSize / thickness;
+            if (m_slabs.size() <= slab)
+                m_slabs.resize(slab + 1);
+            m_slabs[slab].push_back(n);
+        }
+    }
+
+    // A partial sweep updates its pixels slab by slab too
+    std::vector< std::vector<std::size_t> > subset;
+    if (order)
+    {
+        subset.resize(m_slabs.size());
+        for (std::size_t i = 0 ; i < count ; ++i)
+            subset[m_pixelOffsets[order[i]] / sliceSize / thickness].push_back(order[i]);
+    }
+    const std::vector< std::vector<std::size_t> >& slabs = order ? subset : m_slabs;
+
+    // Energies are summed in slab order whatever the thread updating them. The neighborhoods of the candidates may
+    // cover pixels of any slab: they are read from the image as it was before the phase, updated phase by phase
+    std::vector<double> energies(slabs.size(), 0);
+    const CImg<>& candidates = freezeImage();
+    for (std::size_t parity = 0 ; parity < 2 ; ++parity)
+    {
+        const std::size_t nbSlabs = (slabs.size() + 1 - parity) / 2;
+        threadPool().run(nbSlabs, [&](std::size_t i)
+        {
+            const std::size_t slab = 2 * i + parity;
+            for (std::size_t n : slabs[slab])
+                energies[slab] += update(n, m_image, candidates);
+        });
+
+        for (std::size_t slab = parity ; slab < slabs.size() ; slab += 2)
+            commitPixels(slabs[slab]);
+    }
+
+    return std::accumulate(energies.begin(), energies.end(), 0.0);
+}
+
+void AbstractAlgorithm::addStatistics(const PatchDistanceBase::Statistics& statistics)
+{
+    m_nbCandidates.fetch_add(statistics.nbCandidates, std::memory_order_relaxed);
+    m_nbPruned.fetch_add(statistics.nbPruned, std::memory_order_relaxed);
+}
+
+double AbstractAlgorithm::endIteration(double energy)
+{
+    const unsigned long long nbCandidates = m_nbCandidates.exchange(0);
+    const unsigned long long nbPruned = m_nbPruned.exchange(0);
+    const unsigned long long nbChanged = m_nbChanged.exchange(0);
+    const double lastEnergy = m_iterations.empty() ? std::numeric_limits<double>::max() : m_iterations.back().energy;
+    m_iterations.push_back({ energy, std::chrono::steady_clock::now(), nbCandidates, nbPruned });
+
+    if (m_telemetry && m_fileStats)
+    {
+        const double time = m_telemetry->now();
+        const TelemetrySink::Record record = { m_telemetryRun, (unsigned int)m_iterations.size() - 1, energy,
+                                               std::abs(lastEnergy - energy) / lastEnergy, time, time - m_telemetryTime,
+                                               nbCandidates, nbChanged };
+        m_telemetry->push(record);
+        m_telemetryTime = time;
+    }
+
+    return nbCandidates ? double(nbPruned) / double(nbCandidates) : 0;
+}
+
+double AbstractAlgorithm::parallelSweep(std::size_t count, const std::size_t* order, const CImg<>& source, const UpdateFunction& update)
+{
+    const std::size_t nbBlocks = (count + SweepBlockSize - 1) / SweepBlockSize;
+    std::vector<double> energies(nbBlocks, 0);
+    threadPool().run(nbBlocks, [&](std::size_t block)
+    {
+        const std::size_t end = std::min(count, (block + 1) * SweepBlockSize);
+        for (std::size_t n = block * SweepBlockSize ; n < end ; ++n)
+            energies[block] += update(order ? order[n] : n, source, source);
+    });
+
+    return std::accumulate(energies.begin(), energies.end(), 0.0);
+}
@@ -1,10 +1,25 @@
 #ifndef ABSTRACTALGORITHM_H
 #define ABSTRACTALGORITHM_H
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
 
 #include "CImg.h"
 
+#include "patchdistance.h"
+#include "random.h"
+#include "slidingmedian.h"
+#include "telemetrysink.h"
+#include "threadpool.h"
+
 using namespace cimg_library;
 
 /**
@@ -12,6 +27,126 @@ using namespace cimg_library;
  */
 class AbstractAlgorithm
 {
+public:
+    /**
+     * @brief The SweepMode enum Enumerate the ways mask pixels are updated during an iteration.
+     */
+    enum class SweepMode
+    {
+        GAUSS_SEIDEL,   ///< Pixels are updated in place, one after the other.
+        JACOBI,         ///< Pixels read the previous iteration and are updated in parallel.
+        COLORED,        ///< Pixels are updated color by color, pixels of a color in parallel reading the image before their color.
+        SLABS,          ///< Pixels are updated in place, slab by slab, every other slab in parallel reading the candidates before their phase.
+    };
+
+    /**
+     * @brief Function searching the best match of the n-th mask pixel, its neighborhood being read from the first
+     * image and the neighborhoods of the candidates from the second one.
+     * It writes the new pixel value in m_image and returns the distance of the match.
+     */
+    using UpdateFunction = std::function<double(std::size_t, const CImg<>&, const CImg<>&)>;
+
+    /**
+     * @brief The Iteration struct Record of an executed iteration.
+     */
+    struct Iteration
+    {
+        double energy;                                  ///< Energy of the iteration.
+        std::chrono::steady_clock::time_point end;      ///< Time at which the iteration ended.
+        unsigned long long nbCandidates;                ///< Number of candidates considered during the iteration.
+        unsigned long long nbPruned;                    ///< Number of candidates abandoned during the iteration.
+    };
+
+protected:
+    static const std::size_t SweepBlockSize = 256;  ///< Number of mask pixels updated by a parallel task.
+
+private:
+    static const unsigned int SlabThickness = 8;    ///< Number of slices (rows on images) of a slab, at least the patch radius.
+
+    SweepMode m_sweepMode;          ///< Sweep mode.
+    unsigned int m_nbThreads;       ///< Number of threads used by parallel sweeps (0 means one per core).
+    std::unique_ptr<ThreadPool> m_threadPool;   ///< Thread pool, created on first parallel sweep.
+    CImg<> m_previousImage;         ///< Frozen copy of the image read during a Jacobi, colored or slab sweep.
+    std::vector< std::vector<std::size_t> > m_colors;   ///< Mask pixel indices grouped by color, empty if colored sweeps are not supported.
+    std::vector<unsigned int> m_pixelColors;    ///< Color of each mask pixel given to setPixelColor.
+    std::vector<unsigned int> m_pixelOffsets;   ///< Linear index of each mask pixel given to setPixelColor.
+    std::vector< std::vector<std::size_t> > m_slabs;    ///< Mask pixel indices grouped by slab. Built on first slab sweep.
+    unsigned int m_patchRadius;     ///< Radius of the neighborhoods compared by the algorithm.
+
+    bool m_dirtyScheduling;             ///< Only search again the mask pixels whose neighborhood changed.
+    CImg<int> m_pixelIndices;           ///< Index in the mask of each pixel, -1 outside the mask. Built on first scheduled sweep.
+    std::vector<unsigned char> m_dirty;     ///< Flag of the mask pixels searched by the next scheduled sweep.
+    std::vector<std::size_t> m_worklist;    ///< Mask pixels searched by the next scheduled sweep, in mask order.
+    std::vector<unsigned char> m_changed;   ///< Flag of the mask pixels whose value changed during the current sweep.
+    std::vector<double> m_distances;    ///< Distance of the last match of each mask pixel.
+    double m_dirtyEnergy;               ///< Sum of the distances of the last matches.
+    CImg<int> m_matchHeads;             ///< First mask pixel matched to each pixel, -1 if there is none.
+    std::vector<int> m_matchNext;       ///< Next mask pixel matched to the same pixel, -1 at the end of the list.
+    std::vector<int> m_matchPrevious;   ///< Previous mask pixel matched to the same pixel, -1 at the head of the list.
+    std::vector<unsigned int> m_listedMatches;  ///< Match each mask pixel is listed under, UINT_MAX if it is not listed.
+    std::atomic<unsigned long long> m_nbCandidates;     ///< Number of candidates considered during the current iteration.
+    std::atomic<unsigned long long> m_nbPruned;         ///< Number of candidates abandoned during the current iteration.
+    std::atomic<unsigned long long> m_nbChanged;        ///< Number of pixel writes changing a value during the current iteration.
+    std::vector<Iteration> m_iterations;                ///< Records of the executed iterations.
+    std::shared_ptr<TelemetrySink> m_telemetry;         ///< Sink receiving the iteration records, if any.
+    unsigned int m_telemetryRun;    ///< Run number of the algorithm in the sink.
+    double m_telemetryTime;         ///< Sink time at the end of the previous iteration.
+
+    /**
+     * @brief Update mask pixels by blocks on the thread pool.
+     * @param count Number of mask pixels to update.
+     * @param order Indices of the mask pixels to update, nullptr to update pixels [0, count).
+     * @param source Image the neighborhoods of the pixels and of their candidates are read from.
+     * @param update Function updating one mask pixel.
+     * @return Sum of the distances of the updated pixels.
+     */
+    double parallelSweep(std::size_t count, const std::size_t* order, const CImg<>& source, const UpdateFunction& update);
+
+    /**
+     * @brief Copy the new values of mask pixels into the frozen copy of the image.
+     * @param pixels Indices of the mask pixels given to setPixelColor.
+     */
+    void commitPixels(const std::vector<std::size_t>& pixels);
+
+    /**
+     * @brief Update mask pixels once according to the sweep mode, without dirty-set scheduling.
+     * @param count Number of mask pixels to update.
+     * @param order Indices of the mask pixels to update in increasing order, nullptr to update pixels [0, count).
+     * @param update Function updating one mask pixel.
+     * @return Sum of the distances of the updated pixels.
+     */
+    double sweepAll(std::size_t count, const std::size_t* order, const UpdateFunction& update);
+
+    /**
+     * @brief Update mask pixels once, slab by slab. Slabs are layers of SlabThickness slices (rows on images),
+     * each one swept in place in mask order. Even slabs are updated in parallel, then odd ones: two slabs updated
+     * together are a whole slab apart, so that their pixels never read each other. The neighborhoods of the candidates
+     * may cover any slab, they are read from a copy of the image made before the phase.
+     * @param count Number of mask pixels to update.
+     * @param order Indices of the mask pixels to update in increasing order, nullptr to update pixels [0, count).
+     * @param update Function updating one mask pixel.
+     * @return Sum of the distances of the updated pixels.
+     */
+    double sweepSlabs(std::size_t count, const std::size_t* order, const UpdateFunction& update);
+
+    /**
+     * @brief Update the dirty mask pixels according to the sweep mode, then mark as dirty for the next sweep the
+     * pixels around the changed ones and the pixels matched to a candidate whose neighborhood covers a changed one.
+     * Clean pixels keep their last distance, the sweep only visits the dirty and changed pixels.
+     * @param count Number of mask pixels.
+     * @param matches Linear index of the match of each mask pixel after its update, nullptr if there is none.
+     * @param update Function updating one mask pixel.
+     * @return Energy of the iteration.
+     */
+    double sweepDirty(std::size_t count, const unsigned int* matches, const UpdateFunction& update);
+
+    /**
+     * @brief Move a mask pixel to the list of its new match.
+     * @param n Index of the pixel in the mask.
+     * @param match Linear index of its match.
+     */
+    void listMatch(std::size_t n, unsigned int match);
+
 protected:
     bool m_verbose;     ///< Verbose mode.
     bool m_fileStats;   ///< Flag that indicate if we generate a statistic file for each iteration.
@@ -22,26 +157,122 @@ protected:
     double m_gapPercentage;         ///< Gap percentage between last energy computed and median that is used to premautraly stop the algorithm.
     double m_lastMedian;            ///< Last iteration median.
     std::deque<double> m_lastEnergies;  ///< Store nbStoredEnergies elements corresponding to last iterations energies.
+    SlidingMedian m_energyMedian;   ///< Median of the stored energies.
 
     CImg<> m_image;     ///< Image.
+    CImg<bool> m_inMask;    ///< Flag image (or volume) of the pixels that are in the mask.
+
+    unsigned int m_seed;    ///< Seed of the random generator.
+    std::mt19937 m_random;  ///< Random generator of the algorithm, so that its results do not depend on the thread running it.
 
     /**
-     * @brief Check if the algorithm should end prematuraly.
+     * @brief Check if the algorithm should end prematuraly, when the energy stays within the gap of the median of
+     * the previous window. The median is updated in O(log w).
      * @param energy Last energy computed.
      * @return True if algorithm should stop.
      */
     bool computePrematureStop(double energy);
 
+    /**
+     * @brief Get the thread pool used by parallel sweeps.
+     * @return Thread pool.
+     */
+    ThreadPool& threadPool();
+
+    /**
+     * @brief Copy the image, so that the pixels updated by a Jacobi sweep read the previous iteration.
+     * @return Frozen copy of the image.
+     */
+    const CImg<>& freezeImage();
+
+    /**
+     * @brief Set the radius of the neighborhoods compared by the algorithm, 1 by default. It must be set before the
+     * mask pixels are colored.
+     * @param radius Patch radius.
+     */
+    void setPatchRadius(unsigned int radius)
+    {
+        m_patchRadius = radius;
+    }
+
+    /**
+     * @brief Get the radius of the neighborhoods compared by the algorithm.
+     * @return Patch radius.
+     */
+    unsigned int patchRadius() const
+    {
+        return m_patchRadius;
+    }
+
+    /**
+     * @brief Assign a color to a mask pixel, so that no pixel of a color lies in the neighborhood of another
+     * pixel of the same color. Algorithms calling it for every mask pixel, in index order, support colored sweeps,
+     * slab sweeps and dirty-set scheduling.
+     * @param n Index of the pixel in the mask.
+     * @param x x coordinate of the pixel.
+     * @param y y coordinate of the pixel.
+     * @param z z coordinate of the pixel, 0 on images.
+     */
+    void setPixelColor(std::size_t n, unsigned int x, unsigned int y, unsigned int z = 0);
+
+    /**
+     * @brief Copy every channel of a pixel (or voxel) of an image of the same size as the processed one. The copy is
+     * counted in the statistics of the current iteration if the value changes. Can be called concurrently.
+     * @param offset Linear index of the pixel to write.
+     * @param source Image the pixel is read from.
+     * @param index Linear index of the pixel to read.
+     */
+    void copyPixel(unsigned int offset, const CImg<>& source, unsigned int index)
+    {
+        const unsigned int planeSize = m_image.width() * m_image.height() * m_image.depth();
+        bool changed = false;
+        for (int c = 0 ; c < m_image.spectrum() ; ++c)
+        {
+            const float value = source[index + c * planeSize];
+            changed = changed || m_image[offset + c * planeSize] != value;
+            m_image[offset + c * planeSize] = value;
+        }
+
+        if (changed)
+            m_nbChanged.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Update every mask pixel once according to the sweep mode. With dirty-set scheduling, only the pixels
+     * whose neighborhood or match neighborhood changed during the previous sweep are updated.
+     * @param count Number of mask pixels.
+     * @param update Function updating one mask pixel.
+     * @param matches Linear index of the match of each mask pixel after its update, nullptr if the algorithm keeps
+     * none. Dirty-set scheduling then only tracks the neighborhoods of the mask pixels.
+     * @return Energy of the iteration.
+     */
+    double sweep(std::size_t count, const UpdateFunction& update, const unsigned int* matches = nullptr);
+
+    /**
+     * @brief Accumulate the counters of a search. Can be called concurrently.
+     * @param statistics Counters of the search.
+     */
+    void addStatistics(const PatchDistanceBase::Statistics& statistics);
+
+    /**
+     * @brief Record the end of an iteration with the counters of its searches, and reset the counters. The record
+     * is sent to the telemetry sink if statistics are produced.
+     * @param energy Energy of the iteration.
+     * @return Ratio of candidates abandoned early during the iteration, between 0 and 1.
+     */
+    double endIteration(double energy);
+
 public:
     /**
      * @brief Constructor
-     * @param input Image that will be treated.
+     * @param input Image (or volume) that will be treated.
      * @param nbIteration Number of iterations to perform.
      * @param prematureStop Flag for premature stop.
      * @param windowsSize Window size.
      * @param gapPercentage Gap percentage to use.
      * @param verbose Use verbose mode.
      * @param produceStats Algorithm will produce file for statistics.
+     * @param seed Seed of the random generator.
      */
     AbstractAlgorithm(CImg<> input,
                       unsigned int nbIteration = 5,
@@ -49,7 +280,8 @@ public:
                       unsigned int windowSize = 10,
                       double gapPercentage = 0.01,
                       bool verbose = false,
-                      bool produceStats = false);
+                      bool produceStats = false,
+                      unsigned int seed = DefaultSeed);
 
     /**
      * @brief Destructor.
@@ -61,6 +293,13 @@ public:
      */
     virtual void exec() =0;
 
+    /**
+     * @brief Replace the random initialization of the mask pixels by a guess, e.g. the upsampled result of a
+     * coarser resolution.
+     * @param guess Image of the same size as the input image, only its mask pixels are used.
+     */
+    void initialize(const CImg<>& guess);
+
     /**
      * @brief Get the resulting image after an execution of exec, otherwise input image.
      * @return CImg image.
@@ -70,6 +309,15 @@ public:
         return m_image;
     }
 
+    /**
+     * @brief Get the seed of the random generator.
+     * @return Seed.
+     */
+    unsigned int seed() const
+    {
+        return m_seed;
+    }
+
     /**
      * @brief Check if we are in verbose mode.
      * @return True if activated, otherwise false.
@@ -106,6 +354,21 @@ public:
         m_fileStats = stats;
     }
 
+    /**
+     * @brief Send the records of the next iterations to a telemetry sink, if statistics are produced.
+     * @param sink Telemetry sink, nullptr to stop sending records.
+     */
+    void setTelemetry(std::shared_ptr<TelemetrySink> sink);
+
+    /**
+     * @brief Get the records of the iterations executed so far.
+     * @return Iterations, in execution order.
+     */
+    const std::vector<Iteration>& iterations() const
+    {
+        return m_iterations;
+    }
+
     /**
      * @brief Get the number of iterations to perform when using exec.
      * @return Number of iterations.
@@ -160,6 +423,66 @@ public:
     {
         m_gapPercentage = gap;
     }
+
+    /**
+     * @brief Get the sweep mode.
+     * @return Sweep mode.
+     */
+    SweepMode sweepMode() const
+    {
+        return m_sweepMode;
+    }
+
+    /**
+     * @brief Set the sweep mode.
+     * @param mode Sweep mode.
+     */
+    void setSweepMode(SweepMode mode)
+    {
+        m_sweepMode = mode;
+    }
+
+    /**
+     * @brief Check if dirty-set scheduling is used.
+     * @return True if activated, otherwise false.
+     */
+    bool dirtyScheduling() const
+    {
+        return m_dirtyScheduling;
+    }
+
+    /**
+     * @brief Set the dirty-set scheduling state. When activated, a sweep only searches again the mask pixels that
+     * changed, have a neighbor that changed or are matched to a candidate whose neighborhood changed during the
+     * previous sweep. This is an approximation: the neighborhoods of the other candidates next to the mask change
+     * too, but are not tracked.
+     * @param state Dirty-set scheduling flag.
+     */
+    void setDirtyScheduling(bool state)
+    {
+        m_dirtyScheduling = state;
+        m_dirty.clear();
+    }
+
+    /**
+     * @brief Get the number of threads used by parallel sweeps.
+     * @return Number of threads, 0 means one per core.
+     */
+    unsigned int nbThreads() const
+    {
+        return m_nbThreads;
+    }
+
+    /**
+     * @brief Set the number of threads used by parallel sweeps.
+     * @param nbThreads Number of threads, 0 means one per core.
+     */
+    void setNbThreads(unsigned int nbThreads)
+    {
+        if (nbThreads != m_nbThreads)
+            m_threadPool.reset();
+        m_nbThreads = nbThreads;
+    }
 };
 
 #endif // ABSTRACTALGORITHM_H
@@ -0,0 +1,138 @@
+#include "batchrunner.h"
+
+#include "threadpool.h"
+
+#include "CImg.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace cimg_library;
+
+BatchRunner::Job::Job(BatchRunner& runner, unsigned int line)
+    : m_runner(runner)
+    , m_line(line)
+    , m_reserved(0)
+{
+
+}
+
+BatchRunner::Job::~Job()
+{
+    m_runner.release(m_reserved);
+}
+
+void BatchRunner::Job::reserve(std::size_t bytes)
+{
+    m_reserved += m_runner.acquire(bytes);
+}
+
+BatchRunner::BatchRunner(JobFunction function,
+                         unsigned int nbJobs,
+                         std::size_t memoryLimit,
+                         bool verbose)
+    : m_function(function)
+    , m_nbJobs(nbJobs)
+    , m_memoryLimit(memoryLimit)
+    , m_verbose(verbose)
+    , m_reserved(0)
+{
+
+}
+
+std::size_t BatchRunner::acquire(std::size_t bytes)
+{
+    if (m_memoryLimit == 0)
+        return 0;
+
+    bytes = std::min(bytes, m_memoryLimit);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_released.wait(lock, [&]{ return m_reserved + bytes <= m_memoryLimit; });
+    m_reserved += bytes;
+
+    return bytes;
+}
+
+void BatchRunner::release(std::size_t bytes)
+{
+    if (bytes == 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_reserved -= bytes;
+    }
+    m_released.notify_all();
+}
+
+std::vector<std::string> BatchRunner::split(const std::string& line)
+{
+    std::vector<std::string> arguments;
+    std::istringstream stream(line);
+    std::string argument;
+    while (stream >> argument)
+    {
+        if (arguments.empty() && argument[0] == '#')
+            break;
+        arguments.push_back(argument);
+    }
+
+    return arguments;
+}
+
+unsigned int BatchRunner::exec(const std::string& manifestFile, int argc, const char* const* argv)
+{
+    std::ifstream manifest(manifestFile);
+    if (!manifest)
+        throw CImgIOException("BatchRunner: cannot read the manifest '%s'.", manifestFile.c_str());
+
+    // Jobs are read beforehand, with their manifest line
+    std::vector< std::vector<std::string> > jobs;
+    std::vector<unsigned int> lines;
+    std::string text;
+    for (unsigned int line = 1 ; std::getline(manifest, text) ; ++line)
+    {
+        std::vector<std::string> arguments = split(text);
+        if (arguments.empty())
+            continue;
+
+        jobs.push_back(std::move(arguments));
+        lines.push_back(line);
+    }
+
+    ThreadPool pool(m_nbJobs);
+    if (m_verbose)
+    {
+        std::cout << "Batch : " << jobs.size() << " jobs on " << pool.size() << " threads" << std::endl;
+    }
+
+    std::atomic<unsigned int> nbFailed(0);
+    std::mutex outputMutex;
+    pool.run(jobs.size(), [&](std::size_t j)
+    {
+        // Job options come first so that they take precedence over the command line ones
+        std::vector<const char*> arguments(1, argv[0]);
+        for (const std::string& argument : jobs[j])
+            arguments.push_back(argument.c_str());
+        arguments.insert(arguments.end(), argv + 1, argv + argc);
+
+        try
+        {
+            Job job(*this, lines[j]);
+            m_function(arguments.size(), arguments.data(), job);
+        }
+        catch (const std::exception& e)
+        {
+            ++nbFailed;
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cerr << manifestFile << ":" << lines[j] << ": " << e.what() << std::endl;
+        }
+    });
+
+    return nbFailed;
+}
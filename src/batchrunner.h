@@ -0,0 +1,126 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The BatchRunner class Runs the jobs of a manifest concurrently, inside a single process.
+ *
+ * The manifest holds one job per line, written with the command line options ("-if in.bmp -of out.bmp -a 2 ...").
+ * Blank lines and lines starting with '#' are ignored. The options of a job take precedence over the ones of the
+ * process command line, which act as defaults. Jobs reserve their estimated memory before solving and wait until the
+ * total reserved memory fits in the limit.
+ */
+class BatchRunner
+{
+public:
+    /**
+     * @brief The Job class Job of the manifest, given to the job function.
+     */
+    class Job
+    {
+    private:
+        BatchRunner& m_runner;          ///< Runner executing the job.
+        unsigned int m_line;            ///< Line of the job in the manifest.
+        std::size_t m_reserved;         ///< Memory reserved by the job, in bytes.
+
+        friend class BatchRunner;
+
+    public:
+        /**
+         * @brief Constructor
+         * @param runner Runner executing the job.
+         * @param line Line of the job in the manifest.
+         */
+        Job(BatchRunner& runner, unsigned int line);
+
+        /**
+         * @brief Destructor. Release the memory reserved by the job.
+         */
+        ~Job();
+
+        Job(const Job&) = delete;
+        Job& operator=(const Job&) = delete;
+
+        /**
+         * @brief Reserve memory for the job, waiting until it fits in the limit. A job reserves its memory once,
+         * a reservation larger than the limit waiting for every other job to release theirs.
+         * @param bytes Estimated memory used by the job, in bytes.
+         */
+        void reserve(std::size_t bytes);
+
+        /**
+         * @brief Get the line of the job in the manifest.
+         * @return Line number, starting at 1.
+         */
+        unsigned int line() const
+        {
+            return m_line;
+        }
+    };
+
+    /**
+     * @brief Function executing a job from its arguments, the job options followed by the command line ones.
+     * Errors are reported by throwing exceptions.
+     */
+    using JobFunction = std::function<void(int argc, const char* const* argv, Job& job)>;
+
+private:
+    JobFunction m_function;         ///< Execution of a job.
+    unsigned int m_nbJobs;          ///< Number of jobs run concurrently.
+    std::size_t m_memoryLimit;      ///< Maximum memory reserved by the running jobs, in bytes (0 means no limit).
+    bool m_verbose;                 ///< Verbose mode.
+
+    std::mutex m_mutex;                 ///< Protects the reserved memory.
+    std::condition_variable m_released; ///< Signals that memory was released.
+    std::size_t m_reserved;             ///< Memory reserved by the running jobs, in bytes.
+
+    /**
+     * @brief Wait until memory can be reserved, then reserve it.
+     * @param bytes Memory to reserve, in bytes.
+     * @return Memory actually reserved, clamped to the limit.
+     */
+    std::size_t acquire(std::size_t bytes);
+
+    /**
+     * @brief Release reserved memory.
+     * @param bytes Memory to release, in bytes.
+     */
+    void release(std::size_t bytes);
+
+public:
+    /**
+     * @brief Constructor
+     * @param function Execution of a job.
+     * @param nbJobs Number of jobs run concurrently, 0 means one per core.
+     * @param memoryLimit Maximum memory reserved by the running jobs, in bytes. 0 means no limit.
+     * @param verbose Use verbose mode.
+     */
+    BatchRunner(JobFunction function,
+                unsigned int nbJobs = 0,
+                std::size_t memoryLimit = 0,
+                bool verbose = false);
+
+    /**
+     * @brief Split a manifest line into arguments.
+     * @param line Line of the manifest.
+     * @return Arguments separated by whitespaces, empty for blank and comment lines.
+     */
+    static std::vector<std::string> split(const std::string& line);
+
+    /**
+     * @brief Run every job of a manifest. A failing job is reported and does not stop the others.
+     * @param manifestFile Manifest file name.
+     * @param argc Number of command line arguments.
+     * @param argv Command line arguments, used as defaults for the job options.
+     * @return Number of failed jobs. Throws a CImgIOException if the manifest cannot be read.
+     */
+    unsigned int exec(const std::string& manifestFile, int argc, const char* const* argv);
+};
+
+#endif // BATCHRUNNER_H
@@ -0,0 +1,282 @@
+#include <cstdlib>
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "CImg.h"
+
+#include "deterministicalgorithm.h"
+#include "probabilisticalgorithm.h"
+#include "codebookdeterministic.h"
+#include "codebookprobabilistic.h"
+
+using namespace cimg_library;
+
+/**
+ * @brief The Method enum Enumerate the benchmarked algorithms, numbered as the -a option of imagerie.
+ */
+enum Method
+{
+    DETERMINISTIC = 1,
+    DETERMINISTIC_CODEBOOK = 2,
+    PROBABILISTIC = 3,
+    PROBABILISTIC_CODEBOOK = 4,
+};
+
+/**
+ * @brief Generate a textured image with a mask made of random disks.
+ * @param size Width and height of the image.
+ * @param maskFraction Fraction of the pixels in the mask.
+ * @param seed Seed of the random generator.
+ * @return Image, mask pixels having the value 255 and the other ones lying in [0, 254].
+ */
+CImg<> generateInput(unsigned int size, double maskFraction, unsigned int seed);
+
+/**
+ * @brief Get the peak resident set size of the process.
+ * @return Peak RSS in KiB.
+ */
+long peakRss();
+
+/**
+ * @brief Get the name of a method.
+ * @param method Method.
+ * @return Name, as in the Method enum.
+ */
+const char* methodName(int method);
+
+/**
+ * @brief Create a benchmarked algorithm comparing patches of a given radius.
+ * @param method Method.
+ * @param input Image that will be treated.
+ * @param neighborhoodSize Neighborhood size of the codebook methods.
+ * @param nbIterations Maximum number of iterations.
+ * @param prematureStop Flag for premature stop.
+ * @param windowSize Window size used to perform premature stop.
+ * @param gap Gap in percentage to use to compare to median.
+ * @return Algorithm, nullptr if the method is unknown.
+ */
+template<unsigned int Radius>
+AbstractAlgorithm* createMethod(int method, const CImg<>& input, unsigned int neighborhoodSize, unsigned int nbIterations,
+                                bool prematureStop, unsigned int windowSize, double gap);
+
+/// MAIN ///
+int main(int argc, char** argv)
+{
+    const unsigned int size = cimg_option("-size", 256, "Width and height of the generated image");
+    const double maskFraction = cimg_option("-mf", 0.05, "Fraction of the pixels in the mask");
+    const unsigned int seed = cimg_option("-seed", 123456789, "Seed of the generated image");
+    const unsigned int neighborhoodSize = cimg_option("-ns", 20, "For Codebook optimization define the neighborhood size to consider");
+    const unsigned int patchRadius = cimg_option("-pr", 1, "Patch radius: 1 = 3x3, 2 = 5x5, 3 = 7x7, 4 = 9x9");
+    const unsigned int nbIterations = cimg_option("-n", 10, "Maximum number of iterations");
+    const bool prematureStop = cimg_option("-p", true, "Enable/Disable premature stop (default enabled)");
+    const unsigned int windowSize = cimg_option("-w", 10, "Window size used to perform premature stop");
+    const double gap = cimg_option("-g", 0.01, "Gap in percentage to use to compare to median");
+    const bool dirtyScheduling = cimg_option("-ds", false, "Dirty-set scheduling: only search again the mask pixels whose neighborhood changed");
+    const double tolerance = cimg_option("-ct", 0.01, "Relative distance to the final energy at which an iteration counts as converged");
+    const char* methods = cimg_option("-a", "1,2,3,4", "Comma separated methods to run (1 to 4, numbered as in imagerie). Peak RSS is process-wide, run one method per process for exact figures");
+    const char* outputFile = cimg_option("-o", "", "Output JSON file name (empty = standard output)");
+
+    const CImg<> input = generateInput(size, maskFraction, seed);
+    std::size_t nbMaskPixels = 0;
+    cimg_for(input, value, float)
+    {
+        if (*value == 255)
+            ++nbMaskPixels;
+    }
+
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"size\": " << size << ",\n"
+         << "  \"maskFraction\": " << maskFraction << ",\n"
+         << "  \"maskPixels\": " << nbMaskPixels << ",\n"
+         << "  \"seed\": " << seed << ",\n"
+         << "  \"neighborhoodSize\": " << neighborhoodSize << ",\n"
+         << "  \"patchRadius\": " << patchRadius << ",\n"
+         << "  \"maxIterations\": " << nbIterations << ",\n"
+         << "  \"prematureStop\": " << (prematureStop ? "true" : "false") << ",\n"
+         << "  \"dirtyScheduling\": " << (dirtyScheduling ? "true" : "false") << ",\n"
+         << "  \"results\": [";
+
+    std::stringstream list(methods);
+    std::string item;
+    bool first = true;
+    while (std::getline(list, item, ','))
+    {
+        const int method = std::atoi(item.c_str());
+        std::unique_ptr<AbstractAlgorithm> algo;
+        switch (patchRadius)
+        {
+        case 1:
+            algo.reset(createMethod<1>(method, input, neighborhoodSize, nbIterations, prematureStop, windowSize, gap));
+            break;
+        case 2:
+            algo.reset(createMethod<2>(method, input, neighborhoodSize, nbIterations, prematureStop, windowSize, gap));
+            break;
+        case 3:
+            algo.reset(createMethod<3>(method, input, neighborhoodSize, nbIterations, prematureStop, windowSize, gap));
+            break;
+        case 4:
+            algo.reset(createMethod<4>(method, input, neighborhoodSize, nbIterations, prematureStop, windowSize, gap));
+            break;
+        default:
+            std::cerr << "Unsupported patch radius " << patchRadius << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (!algo)
+        {
+            std::cerr << "Unknown method '" << item << "'" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        algo->setDirtyScheduling(dirtyScheduling);
+
+        const auto start = std::chrono::steady_clock::now();
+        algo->exec();
+        const auto end = std::chrono::steady_clock::now();
+
+        // Totals over the iterations, convergence being the first iteration close enough to the final energy
+        const std::vector<AbstractAlgorithm::Iteration>& iterations = algo->iterations();
+        const double finalEnergy = iterations.empty() ? 0 : iterations.back().energy;
+        unsigned long long nbCandidates = 0, nbPruned = 0;
+        double convergence = -1;
+        for (const auto& iteration : iterations)
+        {
+            nbCandidates += iteration.nbCandidates;
+            nbPruned += iteration.nbPruned;
+            if (convergence < 0 && std::abs(iteration.energy - finalEnergy) <= tolerance * std::abs(finalEnergy))
+                convergence = std::chrono::duration<double>(iteration.end - start).count();
+        }
+
+        const double seconds = std::chrono::duration<double>(end - start).count();
+        json << (first ? "\n" : ",\n")
+             << "    {\n"
+             << "      \"method\": \"" << methodName(method) << "\",\n"
+             << "      \"seconds\": " << seconds << ",\n"
+             << "      \"iterations\": " << iterations.size() << ",\n"
+             << "      \"iterationsPerSecond\": " << (seconds > 0 ? iterations.size() / seconds : 0) << ",\n"
+             << "      \"secondsToConvergence\": " << convergence << ",\n"
+             << "      \"finalEnergy\": " << finalEnergy << ",\n"
+             << "      \"candidates\": " << nbCandidates << ",\n"
+             << "      \"nsPerCandidate\": " << (nbCandidates ? seconds * 1e9 / nbCandidates : 0) << ",\n"
+             << "      \"pruningRate\": " << (nbCandidates ? double(nbPruned) / nbCandidates : 0) << ",\n"
+             << "      \"peakRssKiB\": " << peakRss() << "\n"
+             << "    }";
+        first = false;
+    }
+
+    json << "\n  ]\n}\n";
+
+    if (*outputFile)
+        std::ofstream(outputFile) << json.str();
+    else
+        std::cout << json.str();
+
+    return EXIT_SUCCESS;
+}
+
+/// Other functions ///
+CImg<> generateInput(unsigned int size, double maskFraction, unsigned int seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    // Sum of oriented waves plus noise, so that every neighborhood has a few good matches
+    const unsigned int nbWaves = 6;
+    std::vector<double> fx(nbWaves), fy(nbWaves), phase(nbWaves);
+    for (unsigned int w = 0 ; w < nbWaves ; ++w)
+    {
+        fx[w] = (uniform(generator) - 0.5) * 0.6;
+        fy[w] = (uniform(generator) - 0.5) * 0.6;
+        phase[w] = uniform(generator) * 2 * cimg::PI;
+    }
+
+    CImg<> image(size, size);
+    cimg_forXY(image, x, y)
+    {
+        double value = 127;
+        for (unsigned int w = 0 ; w < nbWaves ; ++w)
+            value += 15 * std::sin(fx[w] * x + fy[w] * y + phase[w]);
+        value += (uniform(generator) - 0.5) * 20;
+        image(x, y) = std::max(0.0, std::min(254.0, std::round(value)));
+    }
+
+    // Disks away from the border until the mask is large enough
+    const int margin = 2;
+    const double interior = size > 2 * margin ? (size - 2 * margin) * (size - 2 * margin) : 0;
+    const std::size_t target = std::min(1.0, maskFraction) * interior;
+    std::size_t nbMaskPixels = 0;
+    while (nbMaskPixels < target)
+    {
+        const int radius = 2 + int(uniform(generator) * 8);
+        const int cx = margin + int(uniform(generator) * (size - 2 * margin));
+        const int cy = margin + int(uniform(generator) * (size - 2 * margin));
+        for (int y = std::max(margin, cy - radius) ; y <= std::min(int(size) - 1 - margin, cy + radius) ; ++y)
+        {
+            for (int x = std::max(margin, cx - radius) ; x <= std::min(int(size) - 1 - margin, cx + radius) ; ++x)
+            {
+                if ((x - cx) * (x - cx) + (y - cy) * (y - cy) <= radius * radius && image(x, y) != 255)
+                {
+                    image(x, y) = 255;
+                    ++nbMaskPixels;
+                }
+            }
+        }
+    }
+
+    return image;
+}
+
+long peakRss()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_maxrss;
+}
+
+const char* methodName(int method)
+{
+    switch (method)
+    {
+    case Method::DETERMINISTIC:
+        return "DETERMINISTIC";
+    case Method::DETERMINISTIC_CODEBOOK:
+        return "DETERMINISTIC_CODEBOOK";
+    case Method::PROBABILISTIC:
+        return "PROBABILISTIC";
+    case Method::PROBABILISTIC_CODEBOOK:
+        return "PROBABILISTIC_CODEBOOK";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+template<unsigned int Radius>
+AbstractAlgorithm* createMethod(int method, const CImg<>& input, unsigned int neighborhoodSize, unsigned int nbIterations,
+                                bool prematureStop, unsigned int windowSize, double gap)
+{
+    switch (method)
+    {
+    case Method::DETERMINISTIC:
+        return new BasicDeterministicAlgorithm<Radius>(input, nbIterations, prematureStop, windowSize, gap);
+    case Method::DETERMINISTIC_CODEBOOK:
+        return new BasicCodebookDeterministic<Radius>(input, neighborhoodSize, nbIterations, prematureStop, windowSize, gap);
+    case Method::PROBABILISTIC:
+        return new BasicProbabilisticAlgorithm<Radius>(input, nbIterations, prematureStop, windowSize, gap);
+    case Method::PROBABILISTIC_CODEBOOK:
+        return new BasicCodebookProbabilistic<Radius>(input, neighborhoodSize, nbIterations, prematureStop, windowSize, gap);
+    default:
+        return nullptr;
+    }
+}
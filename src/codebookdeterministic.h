@@ -1,40 +1,18 @@
 #ifndef CODEBOOKDETERMINISTIC_H
 #define CODEBOOKDETERMINISTIC_H
 
-#include "abstractalgorithm.h"
-
-#include <map>
-#include <vector>
+#include "patchsolver.h"
 
 /**
- * @brief The CodebookDeterministic class Implements the deterministic method using codebook optimization.
+ * @brief The BasicCodebookDeterministic class Implements the deterministic method using codebook optimization: only the pixels of a window around the mask pixel are searched.
  */
-class CodebookDeterministic
-        : public AbstractAlgorithm
+template<unsigned int Radius, unsigned int Dimensions = 2>
+class BasicCodebookDeterministic
+    : public PatchSolver<WindowCandidates, CausalEnergy, BasicPatchDistance<Radius, Dimensions>>
 {
 public:
-    // Data structure defines
-    using Point = std::pair< unsigned int, unsigned int >;
-    using PointSet = std::vector< Point >;
-    using MaskSet = std::map< Point, PointSet >;
-
-private:
-    unsigned int m_neighborhoodSize;    ///< Size of the neighborhood considered.
-
-    MaskSet m_mask;     ///< Pixel that are in the mask.
-    PointSet m_outMask; ///< Pixel that are out the mask.
-
-    /**
-     * @brief Recover all pixels coordinates that need reconstruction.
-     */
-    void computeMask();
-
-    /**
-     * @brief Initialize all pixel from mask to a random value from input image.
-     */
-    void randomInitMask();
+    using Solver = PatchSolver<WindowCandidates, CausalEnergy, BasicPatchDistance<Radius, Dimensions>>;
 
-public:
     /**
      * @brief Constructor
      * @param input Image that will be treated.
@@ -45,20 +23,17 @@ public:
      * @param gapPercentage Gap percentage to use.
      * @param verbose Use verbose mode.
      * @param produceStats Algorithm will produce file for statistics.
+     * @param seed Seed of the random generator.
      */
-    CodebookDeterministic(CImg<> input,
-                      unsigned int neighborhoodSize,
-                      unsigned int nbIteration = 5,
-                      bool prematureStop = true,
-                      unsigned int windowSize = 10,
-                      double gapPercentage = 0.01,
-                      bool verbose = false,
-                      bool produceStats = false);
-
-    /**
-     * @brief Use the deterministic method with codebook optimization to emplace mask pixels.
-     */
-    void exec() override;
+    BasicCodebookDeterministic(CImg<> input,
+                               unsigned int neighborhoodSize,
+                               unsigned int nbIteration = 5,
+                               bool prematureStop = true,
+                               unsigned int windowSize = 10,
+                               double gapPercentage = 0.01,
+                               bool verbose = false,
+                               bool produceStats = false,
+                               unsigned int seed = DefaultSeed);
 
     /**
      * @brief Get the used neighborhood size.
@@ -66,8 +41,11 @@ public:
      */
     unsigned int neighborhoodSize() const
     {
-        return m_neighborhoodSize;
+        return this->m_candidates.neighborhoodSize();
     }
 };
 
+/// BasicCodebookDeterministic on 3x3 neighborhoods.
+using CodebookDeterministic = BasicCodebookDeterministic<1>;
+
 #endif // CODEBOOKDETERMINISTIC_H
@@ -0,0 +1,131 @@
+#include "componentalgorithm.h"
+
+#include <iostream>
+
+ComponentAlgorithm::ComponentAlgorithm(CImg<> input,
+                                       AlgorithmFactory factory,
+                                       unsigned int margin,
+                                       unsigned int patchRadius,
+                                       bool verbose,
+                                       unsigned int seed)
+    : AbstractAlgorithm(input, 1, false, 10, 0.01, verbose, false, seed)
+    , m_factory(factory)
+    , m_margin(margin)
+{
+    setPatchRadius(patchRadius);
+    computeComponents();
+}
+
+void ComponentAlgorithm::computeComponents()
+{
+    // Diagonal pixels are connected, as they are in each other neighborhood
+    m_labels = m_inMask.get_label(true);
+
+    std::vector<int> componentOfLabel(m_labels.max() + 1, -1);
+    cimg_forXY(m_inMask, x, y)
+    {
+        if (!m_inMask(x, y))
+            continue;
+
+        const unsigned int label = m_labels(x, y);
+        if (componentOfLabel[label] < 0)
+        {
+            componentOfLabel[label] = m_components.size();
+            m_components.push_back({ label, 0, { x, x, y, y } });
+        }
+
+        Component& component = m_components[componentOfLabel[label]];
+        ++component.size;
+        component.region.beginX = std::min(component.region.beginX, x);
+        component.region.endX = std::max(component.region.endX, x);
+        component.region.beginY = std::min(component.region.beginY, y);
+        component.region.endY = std::max(component.region.endY, y);
+    }
+
+    // Number of pixels out the mask above and to the left of each pixel, so that the seeds of a region are counted
+    // in constant time
+    CImg<unsigned int> known(m_image.width() + 1, m_image.height() + 1, 1, 1, 0);
+    cimg_forXY(m_inMask, x, y)
+        known(x + 1, y + 1) = known(x, y + 1) + known(x + 1, y) - known(x, y) + (m_inMask(x, y) ? 0 : 1);
+
+    // Seeds are the pixels out the mask having a full neighborhood in the region
+    const int r = patchRadius();
+    const auto hasSeed = [&](const Region& region)
+    {
+        const int beginX = region.beginX + r;
+        const int endX = region.endX - r + 1;
+        const int beginY = region.beginY + r;
+        const int endY = region.endY - r + 1;
+
+        return beginX < endX && beginY < endY
+                && known(endX, endY) + known(beginX, beginY) > known(beginX, endY) + known(endX, beginY);
+    };
+
+    // The margin keeps at least the ring of pixels around the neighborhoods of the border mask pixels. Regions
+    // still without seed (against the image border or among other components) are widened
+    const int margin = std::max<int>(m_margin, r + 1);
+    for (auto& component : m_components)
+    {
+        Region& region = component.region;
+        region = expand(region, margin);
+        while (!hasSeed(region))
+        {
+            if (region.beginX == 0 && region.beginY == 0 && region.endX == m_image.width() - 1 && region.endY == m_image.height() - 1)
+                throw CImgArgumentException("No pixel out the mask has a full %ux%u neighborhood.", 2 * r + 1, 2 * r + 1);
+
+            region = expand(region, margin);
+        }
+    }
+
+    // Largest components first, so that the thread pool ends with the short jobs
+    std::stable_sort(m_components.begin(), m_components.end(), [](const Component& a, const Component& b)
+    {
+        return a.size > b.size;
+    });
+}
+
+ComponentAlgorithm::Region ComponentAlgorithm::expand(const Region& region, int margin) const
+{
+    Region expanded;
+    expanded.beginX = std::max(0, region.beginX - margin);
+    expanded.endX = std::min(m_image.width() - 1, region.endX + margin);
+    expanded.beginY = std::max(0, region.beginY - margin);
+    expanded.endY = std::min(m_image.height() - 1, region.endY + margin);
+
+    return expanded;
+}
+
+void ComponentAlgorithm::exec()
+{
+    if (m_verbose)
+    {
+        std::cout << "Components : " << m_components.size() << std::endl;
+    }
+
+    // Each job seeds its own generator from its component index, so that the results do not depend on the scheduling
+    const CImg<> input(m_image);
+    threadPool().run(m_components.size(), [&](std::size_t c)
+    {
+        const Component& component = m_components[c];
+        const Region& region = component.region;
+
+        std::unique_ptr<AbstractAlgorithm> algorithm = m_factory(input.get_crop(region.beginX, region.beginY, region.endX, region.endY),
+                                                                 seed() + c);
+        algorithm->exec();
+        const CImg<> result = algorithm->getResult();
+        algorithm.reset();
+
+        // Only the pixels of the component are merged, other components may lie in the region
+        for (int y = region.beginY ; y <= region.endY ; ++y)
+        {
+            for (int x = region.beginX ; x <= region.endX ; ++x)
+            {
+                if (m_inMask(x, y) && m_labels(x, y) == component.label)
+                {
+                    cimg_forC(m_image, ch)
+                        m_image(x, y, 0, ch) = result(x - region.beginX, y - region.beginY, 0, ch);
+                }
+            }
+        }
+    });
+}
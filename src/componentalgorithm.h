@@ -0,0 +1,100 @@
+#ifndef COMPONENTALGORITHM_H
+#define COMPONENTALGORITHM_H
+
+#include "abstractalgorithm.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief The ComponentAlgorithm class Runs an algorithm independently on each connected component of the mask.
+ *
+ * Each component is solved on its own region of interest (its bounding box expanded by a context margin of at least
+ * the patch radius plus one, and widened until it holds a seed pixel having a full neighborhood), with its own energy and premature stop, as a job of the thread pool (one after the other with a single thread). Regions are cropped from the input image, so that
+ * jobs never read pixels written by other jobs, and only the pixels of its component are merged back. Each job has
+ * its own random generator, seeded from the index of its component, so that the results do not depend on the
+ * scheduling.
+ */
+class ComponentAlgorithm
+    : public AbstractAlgorithm
+{
+public:
+    /**
+     * @brief Function creating the algorithm solving a component from its region image and the seed of its random
+     * generator.
+     */
+    using AlgorithmFactory = std::function<std::unique_ptr<AbstractAlgorithm>(const CImg<>&, unsigned int)>;
+
+    /**
+     * @brief The Region struct Bounds (inclusive) of a rectangle of pixels.
+     */
+    struct Region
+    {
+        int beginX, endX;
+        int beginY, endY;
+    };
+
+    /**
+     * @brief The Component struct Connected component of the mask.
+     */
+    struct Component
+    {
+        unsigned int label;     ///< Label of the component pixels.
+        std::size_t size;       ///< Number of pixels.
+        Region region;          ///< Region of interest, the bounding box expanded by the margin until it holds a seed.
+    };
+
+private:
+    AlgorithmFactory m_factory;     ///< Creation of the algorithm solving a component.
+    unsigned int m_margin;          ///< Number of context pixels kept around each component bounding box.
+
+    CImg<unsigned int> m_labels;            ///< Label of the connected component of each pixel (8-connectivity).
+    std::vector<Component> m_components;    ///< Components of the mask, largest first.
+
+    /**
+     * @brief Label the connected components of the mask and compute their regions.
+     */
+    void computeComponents();
+
+    /**
+     * @brief Expand a region, clipped to the image.
+     * @param region Region.
+     * @param margin Number of pixels added on each side.
+     * @return Expanded region.
+     */
+    Region expand(const Region& region, int margin) const;
+
+public:
+    /**
+     * @brief Constructor
+     * @param input Image that will be treated.
+     * @param factory Creation of the algorithm solving a component.
+     * @param margin Number of context pixels kept around each component bounding box, at least the patch radius plus one.
+     * @param patchRadius Radius of the neighborhoods compared by the algorithms solving the components.
+     * @param verbose Use verbose mode.
+     * @param seed Seed of the random generator of the first component, the next ones using the following seeds.
+     */
+    ComponentAlgorithm(CImg<> input,
+                       AlgorithmFactory factory,
+                       unsigned int margin = 32,
+                       unsigned int patchRadius = 1,
+                       bool verbose = false,
+                       unsigned int seed = DefaultSeed);
+
+    /**
+     * @brief Solve every component on the thread pool and merge the results.
+     */
+    void exec() override;
+
+    /**
+     * @brief Get the connected components of the mask.
+     * @return Components, largest first.
+     */
+    const std::vector<Component>& components() const
+    {
+        return m_components;
+    }
+};
+
+#endif // COMPONENTALGORITHM_H
@@ -1,37 +1,18 @@
 #ifndef DETERMINISTICALGORITHM_H
 #define DETERMINISTICALGORITHM_H
 
-#include "abstractalgorithm.h"
-
-#include <vector>
+#include "patchsolver.h"
 
 /**
- * @brief The DeterministicAlgorithm class Implements the deterministic method.
+ * @brief The BasicDeterministicAlgorithm class Implements the deterministic method: every seed pixel is searched, on the neighborhood distance.
  */
-class DeterministicAlgorithm
-        : public AbstractAlgorithm
+template<unsigned int Radius, unsigned int Dimensions = 2>
+class BasicDeterministicAlgorithm
+    : public PatchSolver<GlobalCandidates, CausalEnergy, BasicPatchDistance<Radius, Dimensions>>
 {
 public:
-    // Data structure defines
-    using Point = std::pair< unsigned int, unsigned int >;
-    using PointSet = std::vector< Point >;
-    using MaskSet = PointSet;
-
-private:
-    MaskSet m_mask;     ///< Pixel that are in the mask.
-    PointSet m_outMask; ///< Pixel that are out the mask.
+    using Solver = PatchSolver<GlobalCandidates, CausalEnergy, BasicPatchDistance<Radius, Dimensions>>;
 
-    /**
-     * @brief Recover all pixels coordinates that need reconstruction.
-     */
-    void computeMask();
-
-    /**
-     * @brief Initialize all pixel from mask to a random value from input image.
-     */
-    void randomInitMask();
-
-public:
     /**
      * @brief Constructor
      * @param input Image that will be treated.
@@ -41,19 +22,19 @@ public:
      * @param gapPercentage Gap percentage to use.
      * @param verbose Use verbose mode.
      * @param produceStats Algorithm will produce file for statistics.
+     * @param seed Seed of the random generator.
      */
-    DeterministicAlgorithm(CImg<> input,
-                           unsigned int nbIteration = 5,
-                           bool prematureStop = true,
-                           unsigned int windowSize = 10,
-                           double gapPercentage = 0.01,
-                           bool verbose = false,
-                           bool produceStats = false);
-
-    /**
-     * @brief Use the deterministic method to emplace mask pixels.
-     */
-    void exec() override;
+    BasicDeterministicAlgorithm(CImg<> input,
+                                unsigned int nbIteration = 5,
+                                bool prematureStop = true,
+                                unsigned int windowSize = 10,
+                                double gapPercentage = 0.01,
+                                bool verbose = false,
+                                bool produceStats = false,
+                                unsigned int seed = DefaultSeed);
 };
 
+/// BasicDeterministicAlgorithm on 3x3 neighborhoods.
+using DeterministicAlgorithm = BasicDeterministicAlgorithm<1>;
+
 #endif // DETERMINISTICALGORITHM_H
@@ -1,24 +1,26 @@
 #include <cstdlib>
 
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
 
 #include "CImg.h"
 
+#include "batchrunner.h"
 #include "deterministicalgorithm.h"
 #include "probabilisticalgorithm.h"
 #include "codebookdeterministic.h"
 #include "codebookprobabilistic.h"
+#include "componentalgorithm.h"
+#include "patchmatchalgorithm.h"
+#include "pyramidalgorithm.h"
+#include "telemetrysink.h"
+#include "tiledpipeline.h"
 
 using namespace cimg_library;
 
-/**
- * @brief Compare two images and return an image that show the differences between them (Black means equals).
- * @param origin Original image.
- * @param result Result image.
- * @return Image showing the difference.
- */
-CImg<> compare(const CImg<>& origin, const CImg<>& result);
-
 /**
  * @brief The Method enum Enumerate all possible algorithms.
  */
@@ -28,80 +30,511 @@ enum Method
     DETERMINISTIC_CODEBOOK = 2,
     PROBABILISTIC = 3,
     PROBABILISTIC_CODEBOOK = 4,
+    PATCHMATCH = 5,
 };
 
+/**
+ * @brief The Settings struct Options of a run, read from the command line or from a batch manifest line.
+ */
+struct Settings
+{
+    bool verbose;                   ///< Verbose mode.
+    bool fileStats;                 ///< Write the iteration statistics to the telemetry file.
+    const char* telemetryFile;      ///< Telemetry file name.
+    bool prematureStop;             ///< Premature stop.
+    unsigned int windowSize;        ///< Window size used to perform premature stop.
+    double gap;                     ///< Gap in percentage to use to compare to median.
+    bool saveResult;                ///< Save the results to files.
+    const char* originalFile;       ///< Original image file name.
+    const char* inputFile;          ///< Input image file name.
+    const char* maskFile;           ///< Mask image file name, empty if the mask is part of the input.
+    const char* outputFile;         ///< Output file name.
+    const char* outputCompareFile;  ///< Output comparison image file name.
+    unsigned int nbIterations;      ///< Number of iterations.
+    unsigned int neighborhoodSize;  ///< Neighborhood size of the codebook methods.
+    unsigned int patchRadius;       ///< Radius of the patches compared by methods 1 to 4.
+    bool jacobi;                    ///< Parallel Jacobi sweeps.
+    bool batchedSearch;             ///< Jacobi sweeps searching blocks of mask pixels at once.
+    bool seedTree;                  ///< Search the candidates through a k-d tree of their neighborhoods.
+    double treeApproximation;       ///< Tolerated relative excess of the distances found through the tree.
+    bool colored;                   ///< Parallel colored Gauss-Seidel sweeps.
+    bool slabs;                     ///< Parallel slab sweeps.
+    bool dirtyScheduling;           ///< Only search again the mask pixels whose neighborhood changed.
+    unsigned int nbThreads;         ///< Number of threads (0 means one per core).
+    double shrinkFactor;            ///< Shrink factor of the PatchMatch random search window.
+    unsigned int nbLevels;          ///< Number of pyramid levels.
+    int margin;                     ///< Context margin of the region of interest (-1 means whole image).
+    bool components;                ///< Solve the connected components of the mask independently.
+    bool headless;                  ///< Save the results and exit without any display.
+    bool multiChannel;              ///< Inpaint every channel of the images instead of the first one.
+    unsigned int tileSize;          ///< Tile size of the streaming pipeline (0 means disabled).
+    unsigned int halo;              ///< Number of context pixels read around each tile.
+    int method;                     ///< Algorithm to use.
+
+    std::shared_ptr<TelemetrySink> telemetry;   ///< Sink of the iteration statistics, nullptr if they are not written.
+};
+
+/**
+ * @brief Read the options of a run. The telemetry sink is left empty.
+ * @param argc Number of arguments.
+ * @param argv Arguments, the first occurrence of an option being used.
+ * @return Settings.
+ */
+Settings readSettings(int argc, const char* const* argv);
+
+/**
+ * @brief Create the algorithm solving an image, not wrapped in any driver.
+ * @param settings Settings.
+ * @param image Image that will be treated.
+ * @param seed Seed of the random generator.
+ * @return Algorithm.
+ */
+std::unique_ptr<AbstractAlgorithm> createAlgorithm(const Settings& settings, const CImg<>& image, unsigned int seed);
+
+/**
+ * @brief Create the algorithm of methods 1 to 4 comparing patches of a given radius.
+ * @param settings Settings.
+ * @param image Image (or volume, with Dimensions = 3) that will be treated.
+ * @param seed Seed of the random generator.
+ * @return Algorithm.
+ */
+template<unsigned int Radius, unsigned int Dimensions = 2>
+AbstractAlgorithm* createPatchSolver(const Settings& settings, const CImg<>& image, unsigned int seed);
+
+/**
+ * @brief Apply the settings specific to the algorithms of methods 1 to 4.
+ * @param settings Settings.
+ * @param solver Algorithm.
+ * @return Algorithm.
+ */
+template<class Solver>
+AbstractAlgorithm* configurePatchSolver(const Settings& settings, Solver* solver);
+
+/**
+ * @brief Create the algorithm solving an image, wrapped in a pyramid if several levels are asked.
+ * @param settings Settings.
+ * @param image Image that will be treated.
+ * @param seed Seed of the random generator.
+ * @return Algorithm.
+ */
+std::unique_ptr<AbstractAlgorithm> createPyramid(const Settings& settings, const CImg<>& image, unsigned int seed);
+
+/**
+ * @brief Create the algorithm solving a whole input image: per component, in parallel or one after the other, or
+ * directly.
+ * @param settings Settings.
+ * @param input Image that will be treated.
+ * @return Algorithm.
+ */
+std::unique_ptr<AbstractAlgorithm> createSolver(const Settings& settings, const CImg<>& input);
+
+/**
+ * @brief Load an image, keeping its first channel only unless multi-channel mode is set.
+ * @param settings Settings.
+ * @param filename Image file name.
+ * @return Image.
+ */
+CImg<> loadImage(const Settings& settings, const char* filename);
+
+/**
+ * @brief Load the input image, mask pixels being set to 255 in every channel if a mask file is given.
+ * @param settings Settings.
+ * @return Input image.
+ */
+CImg<> loadInput(const Settings& settings);
+
+/**
+ * @brief Compare two images and return an image that show the differences between them (Black means equals).
+ * @param origin Original image.
+ * @param result Result image.
+ * @return Image showing the difference.
+ */
+CImg<> compare(const CImg<>& origin, const CImg<>& result);
+
+/**
+ * @brief Run a job of a batch manifest: solve its input and save the results.
+ * @param argc Number of arguments.
+ * @param argv Job options followed by the command line ones.
+ * @param job Job, used to reserve memory.
+ * @param telemetry Sink shared by the jobs writing statistics, nullptr if statistics are not written.
+ */
+void runJob(int argc, const char* const* argv, BatchRunner::Job& job, std::shared_ptr<TelemetrySink> telemetry);
+
+/**
+ * @brief Estimate the memory used by a batch job before its input is decoded, from the size of its input image.
+ * @param settings Settings of the job.
+ * @return Estimated memory, in bytes.
+ */
+std::size_t estimateJobBytes(const Settings& settings);
+
+/**
+ * @brief Read the size of an image file without decoding it: from the header of .bmp and .cimg files, from the file
+ * size otherwise, taken as one byte per value as in uncompressed 8-bit files.
+ * @param filename Image file name.
+ * @param nbPixels Output number of pixels (or voxels).
+ * @param nbChannels Output number of channels of the decoded image.
+ */
+void readImageSize(const char* filename, std::size_t& nbPixels, unsigned int& nbChannels);
+
+// A job holds 5 float images of the input size: the decoded input, the image of the algorithm, its frozen copy
+// (Jacobi, colored and slab sweeps), the result and the comparison. The mask flags and the indices kept per mask
+// pixel (mask, matches, offsets, colors, dirty-set lists) add about 24 bytes per pixel when the mask covers the image.
+// Candidate structures (-bs, -kd) are not counted.
+static const std::size_t JobImageCopies = 5;        ///< Number of float images of the input size held by a batch job.
+static const std::size_t JobBytesPerPixel = 24;     ///< Memory used per pixel by a batch job besides its images.
+
 /// MAIN ///
 int main(int argc, char** argv)
 {
-    const bool verbose = cimg_option("-v", false, "Verbose mode");
-    const bool fileStats = cimg_option("-f", false, "Write stats to file");
-    const bool prematureStop = cimg_option("-p", true, "Enable/Disable premature stop (default enabled)");
-    const unsigned int windowSize = cimg_option("-w", 10, "Window size tused to perform premature stop");
-    const double gap = cimg_option("-g", 0.01, "Gap in percentage to use to compare to median");
-    const bool saveResult = cimg_option("-s", false, "Save result to file");
-    const char* originalFile = cimg_option("-oif", "images/lenaGray.bmp", "Original image file name");
-    const char* inputFile = cimg_option("-if", "images/lenaGrayHiddenSmall.bmp", "Input image file name");
-    const char* outputFile = cimg_option("-of", "output.bmp", "Output file name");
-    const char* outputCompareFile = cimg_option("-ocf", "outputCompare.bmp", "Output comparison image file name");
-    const unsigned int nbIterations = cimg_option("-n", 5, "Number of iterations");
-    const unsigned int neighborhoodSize = cimg_option("-ns", 20, "For Codebook optimization define the neighborhood size to consider");
-    const int method = cimg_option("-a", Method::DETERMINISTIC_CODEBOOK, "Algorithm to use: \n\
+    Settings settings = readSettings(argc, argv);
+    const char* manifestFile = cimg_option("-batch", "", "Run the jobs of this manifest, one line of options per job (-if, -of, -mask, -oif, -ocf, -a, -n...), the command line options being the defaults. Jobs with -f write their statistics to the command line -tf file");
+    const unsigned int nbJobs = cimg_option("-bj", 0, "Number of batch jobs run concurrently (0 = one per core)");
+    const unsigned int memoryLimit = cimg_option("-bm", 0, "Memory limit of the running batch jobs in MB (0 = no limit)");
+
+    if (settings.fileStats)
+        settings.telemetry = std::make_shared<TelemetrySink>(settings.telemetryFile, TelemetrySink::formatOf(settings.telemetryFile));
+
+    if (*manifestFile)
+    {
+        const auto run = [&](int jobArgc, const char* const* jobArgv, BatchRunner::Job& job)
+        {
+            runJob(jobArgc, jobArgv, job, settings.telemetry);
+        };
+        BatchRunner runner(run, nbJobs, std::size_t(memoryLimit) << 20, settings.verbose);
+        return runner.exec(manifestFile, argc, argv) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (settings.tileSize > 0)
+    {
+        const auto factory = [&](const CImg<>& image, unsigned int seed) { return createPyramid(settings, image, seed); };
+        TiledPipeline(factory, settings.tileSize, settings.halo, settings.verbose).exec(settings.inputFile, settings.outputFile);
+        return EXIT_SUCCESS;
+    }
+
+    // Headless runs only compare the result when an original image is given, as batch jobs do
+    const bool hasOrigin = !settings.headless || cimg::option("-oif", argc, argv, (const char*)0);
+    const CImg<float> origin = hasOrigin ? loadImage(settings, settings.originalFile) : CImg<float>();
+    const CImg<float> input = loadInput(settings);
+
+    CImgDisplay displayInput;
+    if (!settings.headless)
+        displayInput.assign(input, "Input Image");
+
+    std::unique_ptr<AbstractAlgorithm> algo = createSolver(settings, input);
+
+    // Algo
+    algo->exec();
+
+    // Results
+    const CImg<>& result = algo->getResult();
+    const CImg<> comparison = hasOrigin ? compare(origin, result) : CImg<>();
+
+    if (settings.saveResult || settings.headless)
+    {
+        result.save(settings.outputFile);
+        if (hasOrigin)
+            comparison.save(settings.outputCompareFile);
+    }
+
+    if (!settings.headless)
+    {
+        CImgDisplay displayFinalImage(result, "Result Image");
+        CImgDisplay displayCompareImage(comparison, "Compare Image", 0);
+        while (!displayInput.is_closed() || !displayFinalImage.is_closed() || !displayCompareImage.is_closed())
+        {
+            displayInput.wait();
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/// Other functions ///
+Settings readSettings(int argc, const char* const* argv)
+{
+    Settings settings;
+    settings.verbose = cimg_option("-v", false, "Verbose mode");
+    settings.fileStats = cimg_option("-f", false, "Write the statistics of every iteration to the -tf file");
+    settings.telemetryFile = cimg_option("-tf", "stats.csv", "Statistics file name, written as JSON lines for .json and .jsonl files and as CSV otherwise");
+    settings.prematureStop = cimg_option("-p", true, "Enable/Disable premature stop (default enabled)");
+    settings.windowSize = cimg_option("-w", 10, "Window size tused to perform premature stop");
+    settings.gap = cimg_option("-g", 0.01, "Gap in percentage to use to compare to median");
+    settings.saveResult = cimg_option("-s", false, "Save result to file");
+    settings.originalFile = cimg_option("-oif", "images/lenaGray.bmp", "Original image file name");
+    settings.inputFile = cimg_option("-if", "images/lenaGrayHiddenSmall.bmp", "Input image file name");
+    settings.maskFile = cimg_option("-mask", "", "Mask image file name, its non-zero pixels being hidden in the input (empty = mask pixels are 255 in the input)");
+    settings.outputFile = cimg_option("-of", "output.bmp", "Output file name");
+    settings.outputCompareFile = cimg_option("-ocf", "outputCompare.bmp", "Output comparison image file name");
+    settings.nbIterations = cimg_option("-n", 5, "Number of iterations");
+    settings.neighborhoodSize = cimg_option("-ns", 20, "For Codebook optimization define the neighborhood size to consider");
+    settings.patchRadius = cimg_option("-pr", 1, "Patch radius of methods 1 to 4: 1 = 3x3, 2 = 5x5, 3 = 7x7, 4 = 9x9");
+    settings.jacobi = cimg_option("-j", false, "Use parallel Jacobi sweeps (every pixel reads the previous iteration)");
+    settings.batchedSearch = cimg_option("-bs", false, "Use parallel Jacobi sweeps searching blocks of mask pixels against every candidate with a cache-blocked matrix product (methods 1 and 3, same results as -j)");
+    settings.seedTree = cimg_option("-kd", false, "Seed tree: search the candidates through a k-d tree of their neighborhoods, the ones reading the mask being searched exhaustively (methods 1 and 3, same results)");
+    settings.treeApproximation = cimg_option("-ke", 0.0, "Approximation of the seed tree searches: the candidates found are at most 1 + epsilon times farther than the closest ones (0 = same results)");
+    settings.colored = cimg_option("-c", false, "Use parallel colored Gauss-Seidel sweeps: pixels updated color by color, the pixels of a color in parallel (methods 1 to 4)");
+    settings.slabs = cimg_option("-sb", false, "Use parallel slab sweeps: layers of slices (rows on images) swept in place, every other layer in parallel (methods 1 to 4)");
+    settings.dirtyScheduling = cimg_option("-ds", false, "Dirty-set scheduling: only search again the mask pixels whose neighborhood changed during the previous iteration (approximate, methods 1 to 4)");
+    settings.nbThreads = cimg_option("-t", 0, "Number of threads used by parallel sweeps (0 = one per core)");
+    settings.shrinkFactor = cimg_option("-sf", 0.5, "For PatchMatch search define the shrink factor of the random search window");
+    settings.nbLevels = cimg_option("-pl", 1, "Number of pyramid levels, each level being solved with -n iterations (1 = full resolution only)");
+    settings.margin = cimg_option("-roi", -1, "Only process the bounding box of each connected component of the mask expanded by this context margin (at least the patch radius plus one), one component after the other (-1 = whole image)");
+    settings.components = cimg_option("-cc", false, "Solve the connected components of the mask independently, in parallel on -t threads (-roi margin, 32 by default)");
+    settings.headless = cimg_option("-hl", false, "Headless mode: save the result to -of, and its comparison to -ocf if -oif is given, then exit without any display (forced when built without display)") || cimg_display == 0;
+    settings.multiChannel = cimg_option("-mc", false, "Multi-channel mode: inpaint every channel of the images (RGB, multispectral) with one search per mask pixel, instead of the first one. Mask pixels are 255 in every channel");
+    settings.tileSize = cimg_option("-tile", 0, "Stream -if to -of (both float .cimg files) by tiles of this size, without display (0 = disabled)");
+    settings.halo = cimg_option("-th", 32, "Number of context pixels read around each tile");
+    settings.method = cimg_option("-a", Method::DETERMINISTIC_CODEBOOK, "Algorithm to use: \n\
                                                                           1 = Deterministic Method \n\
                                                                           2 = Codebook Optimization (Deterministic Method)\n\
                                                                           3 = Probabilistic Method \n\
-                                                                          4 = Codebook Optimization (Probabilistic Method)");
+                                                                          4 = Codebook Optimization (Probabilistic Method)\n\
+                                                                          5 = PatchMatch Search (Probabilistic Method)");
 
-    const CImg<float> origin = CImg<float>(originalFile).channel(0);
-    const CImg<float> input = CImg<float>(inputFile).channel(0);
-    CImgDisplay displayInput(input, "Input Image");
+    return settings;
+}
 
-    // Create algorithm
-    AbstractAlgorithm* algo = nullptr;
-    switch (method)
+std::unique_ptr<AbstractAlgorithm> createAlgorithm(const Settings& settings, const CImg<>& image, unsigned int seed)
+{
+    std::unique_ptr<AbstractAlgorithm> algo;
+    if (image.depth() > 1)
+    {
+        // Volumes are solved on 3x3x3 neighborhoods
+        if (settings.method == Method::PATCHMATCH)
+            throw CImgArgumentException("PatchMatch does not support volumes.");
+        if (settings.patchRadius != 1)
+            throw CImgArgumentException("Patch radius %u is not in [1, %u] on volumes.", settings.patchRadius, PatchDistanceBase::MaxVolumeRadius);
+
+        algo.reset(createPatchSolver<1, 3>(settings, image, seed));
+    }
+    else if (settings.method == Method::PATCHMATCH)
+        algo.reset(new PatchMatchAlgorithm(image, settings.nbIterations, settings.prematureStop, settings.windowSize, settings.gap, settings.verbose, settings.fileStats, settings.shrinkFactor, seed));
+    else
+    {
+        // Every radius has its own compiled kernels
+        switch (settings.patchRadius)
+        {
+        case 1:
+            algo.reset(createPatchSolver<1>(settings, image, seed));
+            break;
+        case 2:
+            algo.reset(createPatchSolver<2>(settings, image, seed));
+            break;
+        case 3:
+            algo.reset(createPatchSolver<3>(settings, image, seed));
+            break;
+        case 4:
+            algo.reset(createPatchSolver<4>(settings, image, seed));
+            break;
+        default:
+            throw CImgArgumentException("Patch radius %u is not in [1, %u].", settings.patchRadius, PatchDistanceBase::MaxRadius);
+        }
+    }
+
+    if (settings.jacobi || settings.batchedSearch || settings.colored || settings.slabs)
+    {
+        algo->setSweepMode(settings.jacobi || settings.batchedSearch ? AbstractAlgorithm::SweepMode::JACOBI
+                                           : settings.colored ? AbstractAlgorithm::SweepMode::COLORED
+                                                              : AbstractAlgorithm::SweepMode::SLABS);
+        algo->setNbThreads(settings.nbThreads);
+    }
+
+    algo->setDirtyScheduling(settings.dirtyScheduling);
+    if (settings.telemetry)
+        algo->setTelemetry(settings.telemetry);
+
+    return algo;
+}
+
+template<unsigned int Radius, unsigned int Dimensions>
+AbstractAlgorithm* createPatchSolver(const Settings& settings, const CImg<>& image, unsigned int seed)
+{
+    switch (settings.method)
     {
     case Method::DETERMINISTIC:
-        algo = new DeterministicAlgorithm(input, nbIterations, prematureStop, windowSize, gap, verbose, fileStats);
-        break;
+        return configurePatchSolver(settings, new BasicDeterministicAlgorithm<Radius, Dimensions>(image, settings.nbIterations, settings.prematureStop, settings.windowSize, settings.gap, settings.verbose, settings.fileStats, seed));
     case Method::DETERMINISTIC_CODEBOOK:
-        algo = new CodebookDeterministic(input, neighborhoodSize, nbIterations, prematureStop, windowSize, gap, verbose, fileStats);
-        break;
+        return configurePatchSolver(settings, new BasicCodebookDeterministic<Radius, Dimensions>(image, settings.neighborhoodSize, settings.nbIterations, settings.prematureStop, settings.windowSize, settings.gap, settings.verbose, settings.fileStats, seed));
     case Method::PROBABILISTIC:
-        algo = new ProbabilisticAlgorithm(input, nbIterations, prematureStop, windowSize, gap, verbose, fileStats);
-        break;
+        return configurePatchSolver(settings, new BasicProbabilisticAlgorithm<Radius, Dimensions>(image, settings.nbIterations, settings.prematureStop, settings.windowSize, settings.gap, settings.verbose, settings.fileStats, seed));
     case Method::PROBABILISTIC_CODEBOOK:
-        algo = new CodebookProbabilistic(input, neighborhoodSize, nbIterations, prematureStop, windowSize, gap, verbose, fileStats);
-        break;
+        return configurePatchSolver(settings, new BasicCodebookProbabilistic<Radius, Dimensions>(image, settings.neighborhoodSize, settings.nbIterations, settings.prematureStop, settings.windowSize, settings.gap, settings.verbose, settings.fileStats, seed));
     default:
-        algo = new CodebookDeterministic(input, neighborhoodSize, nbIterations, prematureStop, windowSize, gap, verbose, fileStats);
-        break;
+        return configurePatchSolver(settings, new BasicCodebookDeterministic<Radius, Dimensions>(image, settings.neighborhoodSize, settings.nbIterations, settings.prematureStop, settings.windowSize, settings.gap, settings.verbose, settings.fileStats, seed));
     }
-	
-    // Algo
+}
+
+template<class Solver>
+AbstractAlgorithm* configurePatchSolver(const Settings& settings, Solver* solver)
+{
+    solver->setBatchedSearch(settings.batchedSearch);
+    solver->setSeedTree(settings.seedTree);
+    solver->setTreeApproximation(settings.treeApproximation);
+    return solver;
+}
+
+std::unique_ptr<AbstractAlgorithm> createPyramid(const Settings& settings, const CImg<>& image, unsigned int seed)
+{
+    if (settings.nbLevels > 1)
+    {
+        if (image.depth() > 1)
+            throw CImgArgumentException("Pyramids do not support volumes.");
+
+        const auto factory = [&](const CImg<>& level, unsigned int levelSeed) { return createAlgorithm(settings, level, levelSeed); };
+        return std::unique_ptr<AbstractAlgorithm>(new PyramidAlgorithm(image, factory, settings.nbLevels, settings.verbose, seed));
+    }
+
+    return createAlgorithm(settings, image, seed);
+}
+
+std::unique_ptr<AbstractAlgorithm> createSolver(const Settings& settings, const CImg<>& input)
+{
+    const auto factory = [&](const CImg<>& image, unsigned int seed) { return createPyramid(settings, image, seed); };
+
+    // Regions and components are cut in the image plane
+    if (input.depth() > 1 && (settings.components || settings.margin >= 0))
+        throw CImgArgumentException("Regions of interest and components do not support volumes.");
+
+    std::unique_ptr<AbstractAlgorithm> algo;
+    if (settings.components)
+    {
+        // Components are solved in parallel on the -t threads, each one on a single thread. The factory owns its
+        // settings, pyramids keeping a reference to them
+        Settings componentSettings = settings;
+        componentSettings.nbThreads = 1;
+        const auto componentFactory = [componentSettings](const CImg<>& image, unsigned int seed)
+        {
+            return createPyramid(componentSettings, image, seed);
+        };
+        algo.reset(new ComponentAlgorithm(input, componentFactory, settings.margin >= 0 ? settings.margin : 32,
+                                          settings.patchRadius, settings.verbose));
+        algo->setNbThreads(settings.nbThreads);
+    }
+    else if (settings.margin >= 0)
+    {
+        // Regions of interest are the components solved one after the other, each one on the -t threads
+        algo.reset(new ComponentAlgorithm(input, factory, settings.margin, settings.patchRadius, settings.verbose));
+    }
+    else
+        algo = createPyramid(settings, input, DefaultSeed);
+
+    return algo;
+}
+
+CImg<> loadImage(const Settings& settings, const char* filename)
+{
+    CImg<> image(filename);
+    if (!settings.multiChannel)
+        image.channel(0);
+
+    return image;
+}
+
+CImg<> loadInput(const Settings& settings)
+{
+    CImg<> input = loadImage(settings, settings.inputFile);
+    if (*settings.maskFile)
+    {
+        const CImg<> mask = CImg<>(settings.maskFile).channel(0);
+        if (!mask.is_sameXYZ(input))
+            throw CImgArgumentException("Mask '%s' and input '%s' have different sizes.", settings.maskFile, settings.inputFile);
+
+        cimg_forXYZ(input, x, y, z)
+        {
+            if (mask(x, y, z) != 0)
+            {
+                cimg_forC(input, c)
+                    input(x, y, z, c) = 255;
+            }
+        }
+    }
+
+    return input;
+}
+
+void runJob(int argc, const char* const* argv, BatchRunner::Job& job, std::shared_ptr<TelemetrySink> telemetry)
+{
+    Settings settings = readSettings(argc, argv);
+    if (settings.fileStats)
+        settings.telemetry = telemetry;
+
+    // Jobs already run concurrently: each one sweeps on a single thread unless -t is given
+    if (!cimg::option("-t", argc, argv, (const char*)0))
+        settings.nbThreads = 1;
+
+    job.reserve(estimateJobBytes(settings));
+    const CImg<> input = loadInput(settings);
+
+    std::unique_ptr<AbstractAlgorithm> algo = createSolver(settings, input);
     algo->exec();
 
-    // Results
     const CImg<>& result = algo->getResult();
-    const CImg<> comparison = compare(origin, result);
+    result.save(settings.outputFile);
 
-    if (saveResult)
+    // The comparison needs the original image, only given on some jobs
+    if (cimg::option("-oif", argc, argv, (const char*)0))
+        compare(loadImage(settings, settings.originalFile), result).save(settings.outputCompareFile);
+
+    if (settings.verbose)
     {
-        result.save(outputFile);
-        comparison.save(outputCompareFile);
+        std::cout << "Job " << job.line() << " : " << settings.outputFile << std::endl;
     }
+}
 
-    CImgDisplay displayFinalImage(result, "Result Image");
-    CImgDisplay displayCompareImage(comparison, "Compare Image", 0);
-    while (!displayInput.is_closed() || !displayFinalImage.is_closed() || !displayCompareImage.is_closed())
+std::size_t estimateJobBytes(const Settings& settings)
+{
+    std::size_t nbPixels = 0;
+    unsigned int nbChannels = 1;
+    readImageSize(settings.inputFile, nbPixels, nbChannels);
+    if (!settings.multiChannel)
+        nbChannels = 1;
+
+    return nbPixels * (JobImageCopies * nbChannels * sizeof(float) + JobBytesPerPixel);
+}
+
+void readImageSize(const char* filename, std::size_t& nbPixels, unsigned int& nbChannels)
+{
+    std::ifstream file(filename, std::ios::binary);
+    const char* const extension = cimg::split_filename(filename);
+    if (!cimg::strcasecmp(extension, "bmp"))
     {
-        displayInput.wait();
+        // Width and height are little endian 32-bit integers, the height being negative for top-down images.
+        // CImg decodes every .bmp file to 3 channels
+        unsigned char header[26] = { 0 };
+        file.read((char*)header, sizeof(header));
+        const int width = header[18] | header[19] << 8 | header[20] << 16 | header[21] << 24;
+        const int height = header[22] | header[23] << 8 | header[24] << 16 | header[25] << 24;
+        if (file && header[0] == 'B' && header[1] == 'M')
+        {
+            nbPixels = std::size_t(std::abs(width)) * std::abs(height);
+            nbChannels = 3;
+            return;
+        }
     }
+    else if (!cimg::strcasecmp(extension, "cimg"))
+    {
+        // "<number of images> <pixel type> <endianness>" then "<width> <height> <depth> <spectrum>"
+        std::string list, size;
+        std::getline(file, list);
+        std::getline(file, size);
 
-    delete algo;
+        std::size_t width = 0, height = 0, depth = 0;
+        unsigned int spectrum = 0;
+        std::istringstream(size) >> width >> height >> depth >> spectrum;
+        if (file && width * height * depth * spectrum > 0)
+        {
+            nbPixels = width * height * depth;
+            nbChannels = spectrum;
+            return;
+        }
+    }
 
-    return EXIT_SUCCESS;
+    file.clear();
+    file.seekg(0, std::ios::end);
+    nbPixels = file ? std::size_t(file.tellg()) : 0;
+    nbChannels = 1;
 }
 
-/// Other functions ///
 CImg<> compare(const CImg<>& origin, const CImg<>& result)
 {
     CImg<> ret(origin);
@@ -0,0 +1,642 @@
+#include "patchdistance.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PATCHDISTANCE_X86
+#include <immintrin.h>
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace
+{
+
+/**
+ * @brief Candidates given by a list of linear indices.
+ */
+struct IndexedCandidates
+{
+    const unsigned int* indices;    ///< Linear indices of the candidates.
+
+    unsigned int operator[](unsigned int c) const
+    {
+        return indices[c];
+    }
+};
+
+/**
+ * @brief Candidates forming a run of consecutive linear indices.
+ */
+struct ContiguousCandidates
+{
+    unsigned int first;             ///< Linear index of the first candidate.
+
+    unsigned int operator[](unsigned int c) const
+    {
+        return first + c;
+    }
+};
+
+/**
+ * @brief Distance made of the neighborhood term only.
+ */
+struct NoTerm
+{
+};
+
+/**
+ * @brief Single-channel images: the number of neighborhood entries is known at compile time, so that the loops
+ * over the entries are unrolled.
+ */
+template<unsigned int NbEntries>
+struct OneChannel
+{
+    static unsigned int size(unsigned int)
+    {
+        return NbEntries;
+    }
+
+    static unsigned int channels(unsigned int)
+    {
+        return 1;
+    }
+};
+
+/**
+ * @brief Multi-channel images: the number of neighborhood entries depends on the image.
+ */
+struct AnyChannels
+{
+    static unsigned int size(unsigned int size)
+    {
+        return size;
+    }
+
+    static unsigned int channels(unsigned int nbChannels)
+    {
+        return nbChannels;
+    }
+};
+
+using NonCausalTerm = PatchDistanceBase::NonCausalTerm;
+
+/// Number of neighborhood terms accumulated between two pruning tests.
+const unsigned int PruningStep = 2;
+
+/// Scalar ///
+template<class Channels>
+inline float termScalar(NoTerm, const float*)
+{
+    return 0;
+}
+
+template<class Channels>
+inline float termScalar(const NonCausalTerm& term, const float* center)
+{
+    float distance = 0;
+    for (unsigned int ch = 0 ; ch < Channels::channels(term.nbChannels) ; ++ch)
+    {
+        const float value = center[ch * term.planeSize];
+        distance += (term.count * value - 2 * term.sum[ch]) * value;
+    }
+
+    return distance + term.squaredSum;
+}
+
+template<class Channels, class Patch, class Term>
+inline float distanceScalar(const float* data, const Patch& patch, const Term& term, unsigned int candidate)
+{
+    const float* center = data + candidate;
+
+    float distance = termScalar<Channels>(term, center);
+    for (unsigned int k = 0 ; k < Channels::size(patch.size) ; ++k)
+    {
+        const float diff = patch.values[k] - center[patch.offsets[k]];
+        distance += diff * diff;
+    }
+
+    return distance;
+}
+
+template<class Channels, class Patch, class Candidates, class Term>
+void distancesScalar(const float* data, const Patch& patch, const Term& term, Candidates candidates, unsigned int begin, unsigned int count, float* out)
+{
+    for (unsigned int c = begin ; c < count ; ++c)
+        out[c] = distanceScalar<Channels>(data, patch, term, candidates[c]);
+}
+
+template<class Channels, class Patch, class Candidates, class Term>
+float findBestScalar(const float* data, const Patch& patch, const Term& term, Candidates candidates, unsigned int begin, unsigned int count,
+                     float bound, unsigned int& best, PatchDistanceBase::Statistics& statistics)
+{
+    float lowestDist = std::numeric_limits<float>::max();
+    best = begin;
+
+    for (unsigned int c = begin ; c < count ; ++c)
+    {
+        const float* center = data + candidates[c];
+        const float threshold = std::min(bound, lowestDist);
+
+        // Partial distances only grow, the candidate is abandoned as soon as it cannot be the closest
+        float distance = termScalar<Channels>(term, center);
+        bool pruned = false;
+        for (unsigned int k = 0 ; k < Channels::size(patch.size) && !pruned ; ++k)
+        {
+            const float diff = patch.values[k] - center[patch.offsets[k]];
+            distance += diff * diff;
+            pruned = (k % PruningStep == PruningStep - 1) && distance > threshold;
+        }
+
+        if (pruned)
+            ++statistics.nbPruned;
+        else if (distance < lowestDist)
+        {
+            lowestDist = distance;
+            best = c;
+        }
+    }
+
+    statistics.nbCandidates += count - begin;
+
+    return lowestDist;
+}
+
+#ifdef PATCHDISTANCE_X86
+
+/**
+ * @brief Merge the per-lane first minima of a vectorized search with the minimum of the scalar tail.
+ * @return Lowest distance, best holds the position of its first occurrence.
+ */
+inline float reduceLanes(const float* lowestLanes, const unsigned int* indexLanes, unsigned int nbLanes, float lowestDist, unsigned int& best)
+{
+    for (unsigned int l = 0 ; l < nbLanes ; ++l)
+    {
+        if (lowestLanes[l] < lowestDist || (lowestLanes[l] == lowestDist && indexLanes[l] < best))
+        {
+            lowestDist = lowestLanes[l];
+            best = indexLanes[l];
+        }
+    }
+
+    return lowestDist;
+}
+
+/// SSE 4.2 : 4 candidates per instruction ///
+TARGET_SSE42 inline __m128 load4(const float* data, int offset, IndexedCandidates candidates, unsigned int c)
+{
+    return _mm_set_ps(data[candidates[c + 3] + offset], data[candidates[c + 2] + offset],
+                      data[candidates[c + 1] + offset], data[candidates[c] + offset]);
+}
+
+TARGET_SSE42 inline __m128 load4(const float* data, int offset, ContiguousCandidates candidates, unsigned int c)
+{
+    return _mm_loadu_ps(data + candidates[c] + offset);
+}
+
+template<class Channels, class Candidates>
+TARGET_SSE42 inline __m128 term4(NoTerm, const float*, Candidates, unsigned int)
+{
+    return _mm_setzero_ps();
+}
+
+template<class Channels, class Candidates>
+TARGET_SSE42 inline __m128 term4(const NonCausalTerm& term, const float* data, Candidates candidates, unsigned int c)
+{
+    __m128 distance = _mm_setzero_ps();
+    for (unsigned int ch = 0 ; ch < Channels::channels(term.nbChannels) ; ++ch)
+    {
+        const __m128 value = load4(data, ch * term.planeSize, candidates, c);
+        const __m128 factor = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(term.count), value), _mm_set1_ps(2 * term.sum[ch]));
+        distance = _mm_add_ps(distance, _mm_mul_ps(factor, value));
+    }
+
+    return _mm_add_ps(distance, _mm_set1_ps(term.squaredSum));
+}
+
+TARGET_SSE42 inline __m128 min4(__m128 values)
+{
+    values = _mm_min_ps(values, _mm_shuffle_ps(values, values, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_min_ps(values, _mm_shuffle_ps(values, values, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+template<class Channels, class Patch, class Candidates, class Term>
+TARGET_SSE42 inline __m128 distances4(const float* data, const Patch& patch, const Term& term, Candidates candidates, unsigned int c)
+{
+    __m128 distance = term4<Channels>(term, data, candidates, c);
+    for (unsigned int k = 0 ; k < Channels::size(patch.size) ; ++k)
+    {
+        const __m128 diff = _mm_sub_ps(_mm_set1_ps(patch.values[k]), load4(data, patch.offsets[k], candidates, c));
+        distance = _mm_add_ps(distance, _mm_mul_ps(diff, diff));
+    }
+
+    return distance;
+}
+
+template<class Channels, class Patch, class Candidates, class Term>
+TARGET_SSE42 void distancesSSE42(const float* data, const Patch& patch, const Term& term, Candidates candidates, unsigned int count, float* out)
+{
+    unsigned int c = 0;
+    for ( ; c + 4 <= count ; c += 4)
+        _mm_storeu_ps(out + c, distances4<Channels>(data, patch, term, candidates, c));
+
+    distancesScalar<Channels>(data, patch, term, candidates, c, count, out);
+}
+
+template<class Channels, class Patch, class Candidates, class Term>
+TARGET_SSE42 float findBestSSE42(const float* data, const Patch& patch, const Term& term, Candidates candidates, unsigned int count,
+                                 float bound, unsigned int& best, PatchDistanceBase::Statistics& statistics)
+{
+    // Each lane keeps its own first minimum, lanes are reduced at the end
+    __m128 lowest = _mm_set1_ps(std::numeric_limits<float>::max());
+    __m128i lowestIndex = _mm_setzero_si128();
+    __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i step = _mm_set1_epi32(4);
+    __m128 threshold = _mm_set1_ps(bound);
+
+    unsigned int c = 0;
+    for ( ; c + 4 <= count ; c += 4, index = _mm_add_epi32(index, step))
+    {
+        // The 4 candidates are abandoned together once none of them can be the closest
+        __m128 distance = term4<Channels>(term, data, candidates, c);
+        bool pruned = false;
+        for (unsigned int k = 0 ; k < Channels::size(patch.size) && !pruned ; ++k)
+        {
+            const __m128 diff = _mm_sub_ps(_mm_set1_ps(patch.values[k]), load4(data, patch.offsets[k], candidates, c));
+            distance = _mm_add_ps(distance, _mm_mul_ps(diff, diff));
+            pruned = (k % PruningStep == PruningStep - 1) && _mm_movemask_ps(_mm_cmpgt_ps(distance, threshold)) == 0xF;
+        }
+
+        if (pruned)
+        {
+            statistics.nbPruned += 4;
+            continue;
+        }
+
+        const __m128 better = _mm_cmplt_ps(distance, lowest);
+        if (_mm_movemask_ps(better))
+        {
+            lowest = _mm_blendv_ps(lowest, distance, better);
+            lowestIndex = _mm_blendv_epi8(lowestIndex, index, _mm_castps_si128(better));
+            threshold = _mm_min_ps(threshold, min4(lowest));
+        }
+    }
+
+    statistics.nbCandidates += c;
+
+    float lowestLanes[4];
+    unsigned int indexLanes[4];
+    _mm_storeu_ps(lowestLanes, lowest);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(indexLanes), lowestIndex);
+
+    const float lowestDist = findBestScalar<Channels>(data, patch, term, candidates, c, count, _mm_cvtss_f32(threshold), best, statistics);
+    return reduceLanes(lowestLanes, indexLanes, 4, lowestDist, best);
+}
+
+/// AVX2 : 8 candidates per instruction ///
+TARGET_AVX2 inline __m256 load8(const float* data, int offset, IndexedCandidates candidates, unsigned int c)
+{
+    const __m256i centers = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(candidates.indices + c));
+    return _mm256_i32gather_ps(data, _mm256_add_epi32(centers, _mm256_set1_epi32(offset)), 4);
+}
+
+TARGET_AVX2 inline __m256 load8(const float* data, int offset, ContiguousCandidates candidates, unsigned int c)
+{
+    return _mm256_loadu_ps(data + candidates[c] + offset);
+}
+
+template<class Channels, class Candidates>
+TARGET_AVX2 inline __m256 term8(NoTerm, const float*, Candidates, unsigned int)
+{
+    return _mm256_setzero_ps();
+}
+
+template<class Channels, class Candidates>
+TARGET_AVX2 inline __m256 term8(const NonCausalTerm& term, const float* data, Candidates candidates, unsigned int c)
+{
+    __m256 distance = _mm256_setzero_ps();
+    for (unsigned int ch = 0 ; ch < Channels::channels(term.nbChannels) ; ++ch)
+    {
+        const __m256 value = load8(data, ch * term.planeSize, candidates, c);
+        const __m256 factor = _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(term.count), value), _mm256_set1_ps(2 * term.sum[ch]));
+        distance = _mm256_add_ps(distance, _mm256_mul_ps(factor, value));
+    }
+
+    return _mm256_add_ps(distance, _mm256_set1_ps(term.squaredSum));
+}
+
+TARGET_AVX2 inline __m256 min8(__m256 values)
+{
+    values = _mm256_min_ps(values, _mm256_permute2f128_ps(values, values, 1));
+    values = _mm256_min_ps(values, _mm256_shuffle_ps(values, values, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm256_min_ps(values, _mm256_shuffle_ps(values, values, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+template<class Channels, class Patch, class Candidates, class Term>
+TARGET_AVX2 inline __m256 distances8(const float* data, const Patch& patch, const Term& term, Candidates candidates, unsigned int c)
+{
+    __m256 distance = term8<Channels>(term, data, candidates, c);
+    for (unsigned int k = 0 ; k < Channels::size(patch.size) ; ++k)
+    {
+        const __m256 diff = _mm256_sub_ps(_mm256_set1_ps(patch.values[k]), load8(data, patch.offsets[k], candidates, c));
+        distance = _mm256_add_ps(distance, _mm256_mul_ps(diff, diff));
+    }
+
+    return distance;
+}
+
+template<class Channels, class Patch, class Candidates, class Term>
+TARGET_AVX2 void distancesAVX2(const float* data, const Patch& patch, const Term& term, Candidates candidates, unsigned int count, float* out)
+{
+    unsigned int c = 0;
+    for ( ; c + 8 <= count ; c += 8)
+        _mm256_storeu_ps(out + c, distances8<Channels>(data, patch, term, candidates, c));
+
+    distancesScalar<Channels>(data, patch, term, candidates, c, count, out);
+}
+
+template<class Channels, class Patch, class Candidates, class Term>
+TARGET_AVX2 float findBestAVX2(const float* data, const Patch& patch, const Term& term, Candidates candidates, unsigned int count,
+                               float bound, unsigned int& best, PatchDistanceBase::Statistics& statistics)
+{
+    // Each lane keeps its own first minimum, lanes are reduced at the end
+    __m256 lowest = _mm256_set1_ps(std::numeric_limits<float>::max());
+    __m256i lowestIndex = _mm256_setzero_si256();
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i step = _mm256_set1_epi32(8);
+    __m256 threshold = _mm256_set1_ps(bound);
+
+    unsigned int c = 0;
+    for ( ; c + 8 <= count ; c += 8, index = _mm256_add_epi32(index, step))
+    {
+        // The 8 candidates are abandoned together once none of them can be the closest
+        __m256 distance = term8<Channels>(term, data, candidates, c);
+        bool pruned = false;
+        for (unsigned int k = 0 ; k < Channels::size(patch.size) && !pruned ; ++k)
+        {
+            const __m256 diff = _mm256_sub_ps(_mm256_set1_ps(patch.values[k]), load8(data, patch.offsets[k], candidates, c));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(diff, diff));
+            pruned = (k % PruningStep == PruningStep - 1) && _mm256_movemask_ps(_mm256_cmp_ps(distance, threshold, _CMP_GT_OQ)) == 0xFF;
+        }
+
+        if (pruned)
+        {
+            statistics.nbPruned += 8;
+            continue;
+        }
+
+        const __m256 better = _mm256_cmp_ps(distance, lowest, _CMP_LT_OQ);
+        if (_mm256_movemask_ps(better))
+        {
+            lowest = _mm256_blendv_ps(lowest, distance, better);
+            lowestIndex = _mm256_blendv_epi8(lowestIndex, index, _mm256_castps_si256(better));
+            threshold = _mm256_min_ps(threshold, min8(lowest));
+        }
+    }
+
+    statistics.nbCandidates += c;
+
+    float lowestLanes[8];
+    unsigned int indexLanes[8];
+    _mm256_storeu_ps(lowestLanes, lowest);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(indexLanes), lowestIndex);
+
+    const float lowestDist = findBestScalar<Channels>(data, patch, term, candidates, c, count, _mm256_cvtss_f32(threshold), best, statistics);
+    return reduceLanes(lowestLanes, indexLanes, 8, lowestDist, best);
+}
+
+#endif
+
+/// Dispatch ///
+template<class Channels, class Patch, class Candidates, class Term>
+void distancesDispatch(PatchDistanceBase::InstructionSet instructionSet, const float* data, const Patch& patch, const Term& term, Candidates candidates, unsigned int count, float* out)
+{
+    switch (instructionSet)
+    {
+#ifdef PATCHDISTANCE_X86
+    case PatchDistanceBase::InstructionSet::AVX2:
+        distancesAVX2<Channels>(data, patch, term, candidates, count, out);
+        break;
+    case PatchDistanceBase::InstructionSet::SSE42:
+        distancesSSE42<Channels>(data, patch, term, candidates, count, out);
+        break;
+#endif
+    default:
+        distancesScalar<Channels>(data, patch, term, candidates, 0, count, out);
+        break;
+    }
+}
+
+template<class Channels, class Patch, class Candidates, class Term>
+float findBestDispatch(PatchDistanceBase::InstructionSet instructionSet, const float* data, const Patch& patch, const Term& term, Candidates candidates, unsigned int count,
+                       float bound, unsigned int& best, PatchDistanceBase::Statistics& statistics)
+{
+    switch (instructionSet)
+    {
+#ifdef PATCHDISTANCE_X86
+    case PatchDistanceBase::InstructionSet::AVX2:
+        return findBestAVX2<Channels>(data, patch, term, candidates, count, bound, best, statistics);
+    case PatchDistanceBase::InstructionSet::SSE42:
+        return findBestSSE42<Channels>(data, patch, term, candidates, count, bound, best, statistics);
+#endif
+    default:
+        return findBestScalar<Channels>(data, patch, term, candidates, 0, count, bound, best, statistics);
+    }
+}
+
+}
+
+PatchDistanceBase::PatchDistanceBase(unsigned int width, unsigned int height, unsigned int depth, unsigned int nbChannels)
+    : m_nbChannels(nbChannels)
+    , m_planeSize(width * height * depth)
+{
+    if (nbChannels < 1 || nbChannels > MaxChannels)
+        throw CImgArgumentException("PatchDistance: %u channels, at most %u are supported.", nbChannels, MaxChannels);
+}
+
+PatchDistanceBase::InstructionSet PatchDistanceBase::detectInstructionSet()
+{
+#ifdef PATCHDISTANCE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return InstructionSet::AVX2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return InstructionSet::SSE42;
+#endif
+    return InstructionSet::SCALAR;
+}
+
+PatchDistanceBase::NonCausalTerm PatchDistanceBase::nonCausalTerm(const float* references, unsigned int count) const
+{
+    NonCausalTerm term = { float(count), { 0 }, 0, m_nbChannels, m_planeSize };
+    for (unsigned int k = 0 ; k < count ; ++k)
+    {
+        for (unsigned int ch = 0 ; ch < m_nbChannels ; ++ch)
+        {
+            const float reference = references[k * m_nbChannels + ch];
+            term.sum[ch] += reference;
+            term.squaredSum += reference * reference;
+        }
+    }
+
+    return term;
+}
+
+template<unsigned int Radius, unsigned int Dimensions>
+BasicPatchDistance<Radius, Dimensions>::BasicPatchDistance(unsigned int width, unsigned int height, unsigned int depth, unsigned int nbChannels)
+    : PatchDistanceBase(width, height, depth, nbChannels)
+    , m_instructionSet(detectInstructionSet())
+{
+    // Raster order, center excluded
+    const int r = int(Radius);
+    const int rz = Dimensions == 3 ? r : 0;
+    unsigned int k = 0;
+    for (int dz = -rz ; dz <= rz ; ++dz)
+    {
+        for (int dy = -r ; dy <= r ; ++dy)
+        {
+            for (int dx = -r ; dx <= r ; ++dx)
+            {
+                if (dx || dy || dz)
+                    m_offsets[k++] = (dz * int(height) + dy) * int(width) + dx;
+            }
+        }
+    }
+}
+
+template<unsigned int Radius, unsigned int Dimensions>
+void BasicPatchDistance<Radius, Dimensions>::gather(const CImg<>& image, int x, int y, int z, Patch& patch) const
+{
+    patch.size = 0;
+
+    // Insertion sort by decreasing deviation, stable so that equal deviations keep the channel and raster order
+    float deviations[Patch::Size];
+    for (unsigned int ch = 0 ; ch < m_nbChannels ; ++ch)
+    {
+        const int r = int(Radius);
+        const int rz = Dimensions == 3 ? r : 0;
+        float values[PatchSize];
+        unsigned int n = 0;
+        for (int dz = -rz ; dz <= rz ; ++dz)
+        {
+            for (int dy = -r ; dy <= r ; ++dy)
+            {
+                for (int dx = -r ; dx <= r ; ++dx)
+                {
+                    if (dx || dy || dz)
+                        values[n++] = image._atXYZ(x + dx, y + dy, z + dz, ch);
+                }
+            }
+        }
+
+        float mean = 0;
+        for (unsigned int k = 0 ; k < PatchSize ; ++k)
+            mean += values[k];
+        mean /= PatchSize;
+
+        for (unsigned int k = 0 ; k < PatchSize ; ++k)
+        {
+            const float deviation = std::abs(values[k] - mean);
+
+            unsigned int l = patch.size++;
+            for ( ; l > 0 && deviations[l - 1] < deviation ; --l)
+            {
+                deviations[l] = deviations[l - 1];
+                patch.values[l] = patch.values[l - 1];
+                patch.offsets[l] = patch.offsets[l - 1];
+            }
+
+            deviations[l] = deviation;
+            patch.values[l] = values[k];
+            patch.offsets[l] = m_offsets[k] + int(ch * m_planeSize);
+        }
+    }
+}
+
+template<unsigned int Radius, unsigned int Dimensions>
+float BasicPatchDistance<Radius, Dimensions>::distance(const float* data, const Patch& patch, unsigned int candidate) const
+{
+    if (m_nbChannels == 1)
+        return distanceScalar<OneChannel<PatchSize>>(data, patch, NoTerm(), candidate);
+    return distanceScalar<AnyChannels>(data, patch, NoTerm(), candidate);
+}
+
+template<unsigned int Radius, unsigned int Dimensions>
+float BasicPatchDistance<Radius, Dimensions>::distance(const float* data, const Patch& patch, const NonCausalTerm& term, unsigned int candidate) const
+{
+    if (m_nbChannels == 1)
+        return distanceScalar<OneChannel<PatchSize>>(data, patch, term, candidate);
+    return distanceScalar<AnyChannels>(data, patch, term, candidate);
+}
+
+template<unsigned int Radius, unsigned int Dimensions>
+void BasicPatchDistance<Radius, Dimensions>::distances(const float* data, const Patch& patch, const unsigned int* candidates, unsigned int count, float* out) const
+{
+    if (m_nbChannels == 1)
+        distancesDispatch<OneChannel<PatchSize>>(m_instructionSet, data, patch, NoTerm(), IndexedCandidates{ candidates }, count, out);
+    else
+        distancesDispatch<AnyChannels>(m_instructionSet, data, patch, NoTerm(), IndexedCandidates{ candidates }, count, out);
+}
+
+template<unsigned int Radius, unsigned int Dimensions>
+void BasicPatchDistance<Radius, Dimensions>::distances(const float* data, const Patch& patch, const NonCausalTerm& term, const unsigned int* candidates, unsigned int count, float* out) const
+{
+    if (m_nbChannels == 1)
+        distancesDispatch<OneChannel<PatchSize>>(m_instructionSet, data, patch, term, IndexedCandidates{ candidates }, count, out);
+    else
+        distancesDispatch<AnyChannels>(m_instructionSet, data, patch, term, IndexedCandidates{ candidates }, count, out);
+}
+
+template<unsigned int Radius, unsigned int Dimensions>
+void BasicPatchDistance<Radius, Dimensions>::distancesRange(const float* data, const Patch& patch, unsigned int first, unsigned int count, float* out) const
+{
+    if (m_nbChannels == 1)
+        distancesDispatch<OneChannel<PatchSize>>(m_instructionSet, data, patch, NoTerm(), ContiguousCandidates{ first }, count, out);
+    else
+        distancesDispatch<AnyChannels>(m_instructionSet, data, patch, NoTerm(), ContiguousCandidates{ first }, count, out);
+}
+
+template<unsigned int Radius, unsigned int Dimensions>
+float BasicPatchDistance<Radius, Dimensions>::findBest(const float* data, const Patch& patch, const unsigned int* candidates, unsigned int count,
+                                           float bound, unsigned int& best, Statistics& statistics) const
+{
+    if (m_nbChannels == 1)
+        return findBestDispatch<OneChannel<PatchSize>>(m_instructionSet, data, patch, NoTerm(), IndexedCandidates{ candidates }, count, bound, best, statistics);
+    return findBestDispatch<AnyChannels>(m_instructionSet, data, patch, NoTerm(), IndexedCandidates{ candidates }, count, bound, best, statistics);
+}
+
+template<unsigned int Radius, unsigned int Dimensions>
+float BasicPatchDistance<Radius, Dimensions>::findBest(const float* data, const Patch& patch, const NonCausalTerm& term, const unsigned int* candidates, unsigned int count,
+                                           float bound, unsigned int& best, Statistics& statistics) const
+{
+    if (m_nbChannels == 1)
+        return findBestDispatch<OneChannel<PatchSize>>(m_instructionSet, data, patch, term, IndexedCandidates{ candidates }, count, bound, best, statistics);
+    return findBestDispatch<AnyChannels>(m_instructionSet, data, patch, term, IndexedCandidates{ candidates }, count, bound, best, statistics);
+}
+
+template<unsigned int Radius, unsigned int Dimensions>
+float BasicPatchDistance<Radius, Dimensions>::findBestRange(const float* data, const Patch& patch, unsigned int first, unsigned int count,
+                                                float bound, unsigned int& best, Statistics& statistics) const
+{
+    if (m_nbChannels == 1)
+        return findBestDispatch<OneChannel<PatchSize>>(m_instructionSet, data, patch, NoTerm(), ContiguousCandidates{ first }, count, bound, best, statistics);
+    return findBestDispatch<AnyChannels>(m_instructionSet, data, patch, NoTerm(), ContiguousCandidates{ first }, count, bound, best, statistics);
+}
+
+template<unsigned int Radius, unsigned int Dimensions>
+float BasicPatchDistance<Radius, Dimensions>::findBestRange(const float* data, const Patch& patch, const NonCausalTerm& term, unsigned int first, unsigned int count,
+                                                float bound, unsigned int& best, Statistics& statistics) const
+{
+    if (m_nbChannels == 1)
+        return findBestDispatch<OneChannel<PatchSize>>(m_instructionSet, data, patch, term, ContiguousCandidates{ first }, count, bound, best, statistics);
+    return findBestDispatch<AnyChannels>(m_instructionSet, data, patch, term, ContiguousCandidates{ first }, count, bound, best, statistics);
+}
+
+// Kernels of every supported radius
+template class BasicPatchDistance<1>;
+template class BasicPatchDistance<2>;
+template class BasicPatchDistance<3>;
+template class BasicPatchDistance<4>;
+template class BasicPatchDistance<1, 3>;
@@ -0,0 +1,271 @@
+#ifndef PATCHDISTANCE_H
+#define PATCHDISTANCE_H
+
+#include "CImg.h"
+
+using namespace cimg_library;
+
+/**
+ * @brief The PatchDistanceBase class Types and helpers shared by the distance kernels of every patch radius.
+ *
+ * Images may have several channels, stored one plane after the other as in CImg. A neighborhood holds every channel
+ * of its pixels, so that a single search compares all of them.
+ */
+class PatchDistanceBase
+{
+public:
+    static const unsigned int MaxRadius = 4;    ///< Largest patch radius a 2D kernel is compiled for.
+    static const unsigned int MaxVolumeRadius = 1;  ///< Largest patch radius a 3D kernel is compiled for.
+    static const unsigned int MaxChannels = 8;  ///< Largest number of image channels.
+
+    /**
+     * @brief The InstructionSet enum Enumerate the available kernel implementations.
+     */
+    enum class InstructionSet
+    {
+        SCALAR,
+        SSE42,
+        AVX2,
+    };
+
+    /**
+     * @brief The NonCausalTerm struct Sum over reference pixels r and channels c of (v_c - r_c)^2, v being the
+     * candidate itself. It is stored as the sum over c of count * v_c^2 - 2 * sum_c * v_c, plus squaredSum, so that
+     * it costs O(channels) per candidate.
+     */
+    struct NonCausalTerm
+    {
+        float count;                ///< Number of reference pixels.
+        float sum[MaxChannels];     ///< Sum of the reference values of each channel.
+        float squaredSum;           ///< Sum of the squared reference values of every channel.
+        unsigned int nbChannels;    ///< Number of channels.
+        unsigned int planeSize;     ///< Distance between two channels of a pixel in the image buffer.
+    };
+
+    /**
+     * @brief The Statistics struct Counters of a search.
+     */
+    struct Statistics
+    {
+        unsigned long long nbCandidates;    ///< Number of candidates considered.
+        unsigned long long nbPruned;        ///< Number of candidates abandoned before their distance was complete.
+    };
+
+protected:
+    unsigned int m_nbChannels;  ///< Number of channels of the images.
+    unsigned int m_planeSize;   ///< Number of pixels of a channel of the images.
+
+    /**
+     * @brief Constructor
+     * @param width Width of the images the distances will be computed on.
+     * @param height Height of the images.
+     * @param depth Depth of the images.
+     * @param nbChannels Number of channels of the images, at most MaxChannels.
+     */
+    PatchDistanceBase(unsigned int width, unsigned int height, unsigned int depth, unsigned int nbChannels);
+
+public:
+    /**
+     * @brief Detect the best instruction set supported by the processor.
+     * @return Instruction set.
+     */
+    static InstructionSet detectInstructionSet();
+
+    /**
+     * @brief Get the number of channels of the images.
+     * @return Number of channels.
+     */
+    unsigned int nbChannels() const
+    {
+        return m_nbChannels;
+    }
+
+    /**
+     * @brief Build the non-causal term comparing candidate values to a set of reference pixels.
+     * @param references Reference values, the channels of each reference pixel being consecutive.
+     * @param count Number of reference pixels.
+     * @return Non-causal term.
+     */
+    NonCausalTerm nonCausalTerm(const float* references, unsigned int count) const;
+};
+
+/**
+ * @brief The BasicPatchDistance class Computes the distance between the (2 * Radius + 1)^Dimensions neighborhood
+ * (center excluded) of a pixel and the neighborhoods of a set of candidate pixels.
+ *
+ * Candidates are given as linear indices in the image buffer and must lie at least Radius pixels away from the image
+ * border. Several candidates are evaluated at once using AVX2 or SSE4.2 when the processor supports them.
+ * Searches abandon a group of candidates as soon as their partial distances all exceed the best distance found.
+ * The kernels are compiled for every radius from 1 to MaxRadius on images, and up to MaxVolumeRadius on volumes
+ * (Dimensions = 3, 26 neighbors for a radius of 1).
+ */
+template<unsigned int Radius, unsigned int Dimensions = 2>
+class BasicPatchDistance
+    : public PatchDistanceBase
+{
+public:
+    static const unsigned int PatchRadius = Radius;         ///< Radius of the neighborhood.
+    static const unsigned int PatchDimensions = Dimensions; ///< Number of dimensions of the neighborhood, 2 or 3.
+    static const unsigned int PatchSize = (2 * Radius + 1) * (2 * Radius + 1) * (Dimensions == 3 ? 2 * Radius + 1 : 1) - 1; ///< Number of pixels in a neighborhood.
+
+    /**
+     * @brief The Patch struct Neighborhood of a pixel, one entry per pixel and channel, ordered so that the entries
+     * the most likely to reject a candidate come first.
+     */
+    struct Patch
+    {
+        static const unsigned int Size = PatchSize * MaxChannels;  ///< Largest number of entries.
+
+        unsigned int size;  ///< Number of entries, PatchSize times the number of channels.
+        float values[Size]; ///< Values of the neighborhood entries.
+        int offsets[Size];  ///< Linear offsets of the neighborhood entries relative to the center.
+    };
+
+private:
+    int m_offsets[PatchSize];           ///< Linear offsets of the neighborhood pixels relative to the center.
+    InstructionSet m_instructionSet;    ///< Kernel implementation used.
+
+public:
+    /**
+     * @brief Constructor
+     * @param width Width of the images the distances will be computed on.
+     * @param height Height of the images.
+     * @param depth Depth of the images.
+     * @param nbChannels Number of channels of the images, at most MaxChannels.
+     */
+    BasicPatchDistance(unsigned int width, unsigned int height, unsigned int depth, unsigned int nbChannels);
+
+    /**
+     * @brief Get the instruction set used by the kernels.
+     * @return Instruction set.
+     */
+    InstructionSet instructionSet() const
+    {
+        return m_instructionSet;
+    }
+
+    /**
+     * @brief Copy the neighborhood of a pixel. Coordinates outside the image are clamped. Entries are sorted by
+     * decreasing deviation from the neighborhood mean of their channel, as they are the most discriminating.
+     * @param image Image.
+     * @param x x coordinate of the pixel.
+     * @param y y coordinate of the pixel.
+     * @param z z coordinate of the pixel, 0 on 2D images.
+     * @param patch Output neighborhood.
+     */
+    void gather(const CImg<>& image, int x, int y, int z, Patch& patch) const;
+
+    /**
+     * @brief Compute the distance between a neighborhood and the neighborhood of a candidate.
+     * @param data Image buffer.
+     * @param patch Reference neighborhood.
+     * @param candidate Linear index of the candidate.
+     * @return Distance, equal to the one a search computes for this candidate.
+     */
+    float distance(const float* data, const Patch& patch, unsigned int candidate) const;
+
+    /**
+     * @brief Compute the distance between a neighborhood and the neighborhood of a candidate, plus a non-causal term.
+     * @param data Image buffer.
+     * @param patch Reference neighborhood.
+     * @param term Non-causal term, evaluated on the candidate value.
+     * @param candidate Linear index of the candidate.
+     * @return Distance, equal to the one a search computes for this candidate.
+     */
+    float distance(const float* data, const Patch& patch, const NonCausalTerm& term, unsigned int candidate) const;
+
+    /**
+     * @brief Compute the distance between a neighborhood and the neighborhood of each candidate.
+     * @param data Image buffer.
+     * @param patch Reference neighborhood.
+     * @param candidates Linear indices of the candidates.
+     * @param count Number of candidates.
+     * @param out Output distances, one per candidate.
+     */
+    void distances(const float* data, const Patch& patch, const unsigned int* candidates, unsigned int count, float* out) const;
+
+    /**
+     * @brief Compute the distance between a neighborhood and the neighborhood of each candidate, plus a non-causal term.
+     * @param data Image buffer.
+     * @param patch Reference neighborhood.
+     * @param term Non-causal term, evaluated on the candidate values.
+     * @param candidates Linear indices of the candidates.
+     * @param count Number of candidates.
+     * @param out Output distances, one per candidate.
+     */
+    void distances(const float* data, const Patch& patch, const NonCausalTerm& term, const unsigned int* candidates, unsigned int count, float* out) const;
+
+    /**
+     * @brief Compute the distance between a neighborhood and the neighborhood of each candidate of a run of
+     * consecutive pixels. Neighborhoods are loaded without gathering.
+     * @param data Image buffer.
+     * @param patch Reference neighborhood.
+     * @param first Linear index of the first candidate.
+     * @param count Number of candidates.
+     * @param out Output distances, one per candidate.
+     */
+    void distancesRange(const float* data, const Patch& patch, unsigned int first, unsigned int count, float* out) const;
+
+    /**
+     * @brief Find the candidate whose neighborhood is the closest to a neighborhood.
+     * @param data Image buffer.
+     * @param patch Reference neighborhood.
+     * @param candidates Linear indices of the candidates.
+     * @param count Number of candidates.
+     * @param bound Candidates farther than this distance are abandoned.
+     * @param best Position in candidates of the first closest candidate.
+     * @param statistics Counters incremented by the search.
+     * @return Distance of the closest candidate, or the maximum float value if no candidate is within the bound.
+     */
+    float findBest(const float* data, const Patch& patch, const unsigned int* candidates, unsigned int count,
+                   float bound, unsigned int& best, Statistics& statistics) const;
+
+    /**
+     * @brief Find the candidate minimizing its neighborhood distance plus a non-causal term.
+     * @param data Image buffer.
+     * @param patch Reference neighborhood.
+     * @param term Non-causal term, evaluated on the candidate values.
+     * @param candidates Linear indices of the candidates.
+     * @param count Number of candidates.
+     * @param bound Candidates farther than this distance are abandoned.
+     * @param best Position in candidates of the first closest candidate.
+     * @param statistics Counters incremented by the search.
+     * @return Distance of the closest candidate, or the maximum float value if no candidate is within the bound.
+     */
+    float findBest(const float* data, const Patch& patch, const NonCausalTerm& term, const unsigned int* candidates, unsigned int count,
+                   float bound, unsigned int& best, Statistics& statistics) const;
+
+    /**
+     * @brief Find the candidate of a run of consecutive pixels whose neighborhood is the closest to a neighborhood.
+     * @param data Image buffer.
+     * @param patch Reference neighborhood.
+     * @param first Linear index of the first candidate.
+     * @param count Number of candidates.
+     * @param bound Candidates farther than this distance are abandoned.
+     * @param best Position in the run of the first closest candidate.
+     * @param statistics Counters incremented by the search.
+     * @return Distance of the closest candidate, or the maximum float value if no candidate is within the bound.
+     */
+    float findBestRange(const float* data, const Patch& patch, unsigned int first, unsigned int count,
+                        float bound, unsigned int& best, Statistics& statistics) const;
+
+    /**
+     * @brief Find the candidate of a run of consecutive pixels minimizing its neighborhood distance plus a non-causal term.
+     * @param data Image buffer.
+     * @param patch Reference neighborhood.
+     * @param term Non-causal term, evaluated on the candidate values.
+     * @param first Linear index of the first candidate.
+     * @param count Number of candidates.
+     * @param bound Candidates farther than this distance are abandoned.
+     * @param best Position in the run of the first closest candidate.
+     * @param statistics Counters incremented by the search.
+     * @return Distance of the closest candidate, or the maximum float value if no candidate is within the bound.
+     */
+    float findBestRange(const float* data, const Patch& patch, const NonCausalTerm& term, unsigned int first, unsigned int count,
+                        float bound, unsigned int& best, Statistics& statistics) const;
+};
+
+/// Kernel of the 3x3 neighborhood.
+using PatchDistance = BasicPatchDistance<1>;
+
+#endif // PATCHDISTANCE_H
@@ -0,0 +1,203 @@
+#include "patchmatchalgorithm.h"
+
+#include <iostream>
+
+PatchMatchAlgorithm::PatchMatchAlgorithm(CImg<> input,
+                                         unsigned int nbIteration,
+                                         bool prematureStop,
+                                         unsigned int windowSize,
+                                         double gapPercentage,
+                                         bool verbose,
+                                         bool produceStats,
+                                         double shrinkFactor,
+                                         unsigned int seed)
+    : AbstractAlgorithm(input, nbIteration, prematureStop, windowSize, gapPercentage, verbose, produceStats, seed)
+    , m_shrinkFactor(shrinkFactor > 0 && shrinkFactor < 1 ? shrinkFactor : 0.5)
+    , m_mappingMask(input.width(), input.height(), 1, 1, 0)
+    , m_patchDistance(input.width(), input.height(), 1, input.spectrum())
+{
+    computeMask();
+    randomInitMask();
+}
+
+void PatchMatchAlgorithm::computeMask()
+{
+    // Add every pixels in the image that should be reconstructed
+    cimg_forXY(m_image, x, y)
+    {
+        // Blank pixels
+        if (m_inMask(x, y))
+        {
+            m_mask.push_back({ x, y });
+        }
+    }
+
+    cimg_forXY(m_image, x, y)
+    {
+        if (isSeed(x, y))
+            m_outMask.push_back({ x, y });
+    }
+}
+
+void PatchMatchAlgorithm::randomInitMask()
+{
+    const unsigned int nbPixels = m_outMask.size();
+    if (nbPixels == 0 && !m_mask.empty())
+        throw CImgArgumentException("No pixel out the mask has a full 3x3 neighborhood to initialize the mask pixels from.");
+
+    // For each pixel of the mask
+    for (const auto& pixel : m_mask)
+    {
+        unsigned int index = m_random() % (nbPixels);
+        const auto& seedPixel = m_outMask[index];
+
+        // Initialize the color of the pixel to a random pixel color in the seed image
+        m_mappingMask(pixel.first, pixel.second) = m_image.offset(seedPixel.first, seedPixel.second);
+        copyPixel(m_image.offset(pixel.first, pixel.second), m_image, m_image.offset(seedPixel.first, seedPixel.second));
+    }
+}
+
+void PatchMatchAlgorithm::computeDistances(const Point& pixel, const IndexSet& candidates, std::size_t first, std::vector<float>& distances) const
+{
+    const int x = pixel.first;
+    const int y = pixel.second;
+
+    // Second distance: neighbors in the mask are compared to their mirror around the pixel
+    float references[PatchDistance::PatchSize * PatchDistance::MaxChannels];
+    unsigned int nbReferences = 0;
+    unsigned int n = 0;
+    for (int dy = -1 ; dy <= 1 ; ++dy)
+    {
+        for (int dx = -1 ; dx <= 1 ; ++dx)
+        {
+            if ((dx || dy) && m_inMask.atXY(x + dx, y + dy, 0, 0, false))
+            {
+                cimg_forC(m_image, c)
+                    references[n++] = m_image._atXY(x - dx, y - dy, 0, c);
+                ++nbReferences;
+            }
+        }
+    }
+
+    // First distance, computed together with the second one
+    PatchDistance::Patch patch;
+    m_patchDistance.gather(m_image, x, y, 0, patch);
+    distances.resize(candidates.size());
+    m_patchDistance.distances(m_image.data(), patch, m_patchDistance.nonCausalTerm(references, nbReferences),
+                              candidates.data() + first, candidates.size() - first, distances.data() + first);
+}
+
+void PatchMatchAlgorithm::exec()
+{
+    double lastEnergy = std::numeric_limits<double>::max();
+
+    const int width = m_image.width();
+    const int height = m_image.height();
+    const int maxRadius = std::max(width, height);
+
+    IndexSet candidates;
+    std::vector<float> distances;
+
+    bool end = false;
+    unsigned int i = 0;
+    while (!end && i < m_nbIterations)
+    {
+        double energy = 0;
+        PatchDistance::Statistics statistics = { 0, 0 };
+
+        // Alternate scan order so that good correspondences propagate in every direction
+        const bool forward = (i % 2 == 0);
+        const int step = forward ? 1 : -1;
+
+        for (unsigned int n = 0 ; n < m_mask.size() ; ++n)
+        {
+            const auto& pixel = m_mask[forward ? n : m_mask.size() - 1 - n];
+            const int x = pixel.first;
+            const int y = pixel.second;
+
+            const unsigned int current = m_mappingMask(x, y);
+            candidates.assign(1, current);
+
+            // Propagation from the previous neighbors in scan order
+            if (m_inMask.atXY(x - step, y, 0, 0, false))
+            {
+                const unsigned int neighborMatch = m_mappingMask._atXY(x - step, y);
+                const int mx = int(neighborMatch % width) + step;
+                const int my = int(neighborMatch / width);
+                if (isSeed(mx, my))
+                    candidates.push_back(m_image.offset(mx, my));
+            }
+            if (m_inMask.atXY(x, y - step, 0, 0, false))
+            {
+                const unsigned int neighborMatch = m_mappingMask._atXY(x, y - step);
+                const int mx = int(neighborMatch % width);
+                const int my = int(neighborMatch / width) + step;
+                if (isSeed(mx, my))
+                    candidates.push_back(m_image.offset(mx, my));
+            }
+
+            // Keep the current correspondence unless a strictly better one is found
+            computeDistances(pixel, candidates, 0, distances);
+            unsigned int best = 0;
+            for (unsigned int c = 1 ; c < candidates.size() ; ++c)
+            {
+                if (distances[c] < distances[best])
+                    best = c;
+            }
+
+            // Random search around the best correspondence after propagation
+            const unsigned int nbPropagated = candidates.size();
+            const int cx = int(candidates[best] % width);
+            const int cy = int(candidates[best] / width);
+            for (double radius = maxRadius ; radius >= 1 ; radius *= m_shrinkFactor)
+            {
+                const int r = int(radius);
+                const int mx = cx + int(m_random() % (2 * r + 1)) - r;
+                const int my = cy + int(m_random() % (2 * r + 1)) - r;
+                if (isSeed(mx, my))
+                    candidates.push_back(m_image.offset(mx, my));
+            }
+
+            computeDistances(pixel, candidates, nbPropagated, distances);
+            statistics.nbCandidates += candidates.size();
+            for (unsigned int c = nbPropagated ; c < candidates.size() ; ++c)
+            {
+                if (distances[c] < distances[best])
+                    best = c;
+            }
+
+            energy += distances[best];
+
+            // Set new pixel color and update map
+            m_mappingMask(x, y) = candidates[best];
+            copyPixel(m_image.offset(x, y), m_image, candidates[best]);
+        }
+
+        addStatistics(statistics);
+        endIteration(energy);
+
+        // Iteration results
+        double ratio = (lastEnergy - energy) / double(lastEnergy);
+        ratio = ratio > 0 ? ratio : -ratio;
+
+        // Verbose
+        if (m_verbose)
+        {
+            std::cout << "Loop : " << i << "\nLast Energy : " << lastEnergy << "\nEnergy : " << energy << "\nRatio : " << ratio << "\n" << std::endl;
+        }
+
+        lastEnergy = energy;
+
+        if (m_enablePrematureStop && computePrematureStop(energy))
+        {
+            if (m_verbose)
+            {
+                std::cout << "Algorithm prematuraly stopped at iteration: " << i << std::endl;
+            }
+
+            end = true;
+        }
+
+        ++i;
+    }
+}
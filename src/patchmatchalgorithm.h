@@ -0,0 +1,93 @@
+#ifndef PATCHMATCHALGORITHM_H
+#define PATCHMATCHALGORITHM_H
+
+#include "abstractalgorithm.h"
+#include "patchdistance.h"
+
+#include <vector>
+
+/**
+ * @brief The PatchMatchAlgorithm class Implements the probabilistic method using a randomized correspondence search.
+ *
+ * The correspondence map is used as a nearest-neighbor field: at each iteration every mask pixel only tries the
+ * correspondences propagated from its already visited neighbors and a few random seeds taken in windows of
+ * exponentially shrinking size around its current correspondence.
+ */
+class PatchMatchAlgorithm
+    : public AbstractAlgorithm
+{
+public:
+    // Data structure defines
+    using Point = std::pair< unsigned int, unsigned int >;
+    using PointSet = std::vector< Point >;
+    using IndexSet = std::vector< unsigned int >;
+
+private:
+    double m_shrinkFactor;              ///< Ratio between two consecutive random search window sizes.
+
+    PointSet m_mask;                    ///< Pixel that are in the mask.
+    PointSet m_outMask;                 ///< Pixel that are out the mask.
+    CImg<unsigned int> m_mappingMask;   ///< Linear index of the replacing pixel of each pixel in the mask.
+
+    PatchDistance m_patchDistance;      ///< Neighborhood distance kernel.
+
+    /**
+     * @brief Recover all pixels coordinates that need reconstruction.
+     */
+    void computeMask();
+
+    /**
+     * @brief Initialize all pixel from mask to a random value from input image.
+     */
+    void randomInitMask();
+
+    /**
+     * @brief Check if a pixel can be used as a correspondence.
+     * @param x x coordinate of the pixel.
+     * @param y y coordinate of the pixel.
+     * @return True if the pixel is out the mask and has a full neighborhood.
+     */
+    bool isSeed(int x, int y) const
+    {
+        return x > 0 && y > 0 && x < m_image.width() - 1 && y < m_image.height() - 1 && !m_inMask(x, y);
+    }
+
+    /**
+     * @brief Compute the probabilistic distance of a pixel to a set of candidates.
+     * @param pixel Pixel analyzed.
+     * @param candidates Linear indices of the candidates.
+     * @param first Position of the first candidate whose distance is computed, the previous ones being kept.
+     * @param distances Output distances, one per candidate.
+     */
+    void computeDistances(const Point& pixel, const IndexSet& candidates, std::size_t first, std::vector<float>& distances) const;
+
+public:
+    /**
+     * @brief Constructor
+     * @param input Image that will be treated.
+     * @param nbIteration Number of iterations to perform.
+     * @param prematureStop Flag for premature stop.
+     * @param windowsSize Window size.
+     * @param gapPercentage Gap percentage to use.
+     * @param verbose Use verbose mode.
+     * @param produceStats Algorithm will produce file for statistics.
+     * @param shrinkFactor Ratio between two consecutive random search window sizes.
+     * @param seed Seed of the random generator.
+     */
+    PatchMatchAlgorithm(CImg<> input,
+                        unsigned int nbIteration = 5,
+                        bool prematureStop = true,
+                        unsigned int windowSize = 10,
+                        double gapPercentage = 0.01,
+                        bool verbose = false,
+                        bool produceStats = false,
+                        double shrinkFactor = 0.5,
+                        unsigned int seed = DefaultSeed);
+
+    /**
+     * @brief Use the randomized correspondence search to emplace mask pixels.
+     */
+    void exec() override;
+};
+
+#endif // PATCHMATCHALGORITHM_H
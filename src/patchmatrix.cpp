@@ -0,0 +1,416 @@
+#include "patchmatrix.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PATCHMATRIX_X86
+#include <immintrin.h>
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace
+{
+
+/// Number of neighborhoods multiplied together by the inner kernels.
+const unsigned int BlockRows = 4;
+
+/// Number of floats of the panels kept in cache while every neighborhood of a block is multiplied by them.
+const unsigned int ChunkFloats = 32768;
+
+/// Squared norm of the padding seeds of the last panel, large enough for them never to be shortlisted.
+const float PaddingNorm = 1e30f;
+
+/// Number of shortlisted seeds of a neighborhood above which the shortlist is filtered during the search.
+const std::size_t CompactionSize = 4096;
+
+using NonCausalTerm = PatchDistanceBase::NonCausalTerm;
+
+/**
+ * @brief Seed shortlisted with the lower bound of its distance.
+ */
+struct Candidate
+{
+    unsigned int position;  ///< Position of the seed.
+    float lower;            ///< Lower bound of the distance computed by the kernels.
+};
+
+/**
+ * @brief State of a neighborhood during a search.
+ */
+struct Row
+{
+    const float* values;        ///< Neighborhood entries.
+    float norm;                 ///< Squared norm of the neighborhood.
+    const NonCausalTerm* term;  ///< Non-causal term, nullptr if there is none.
+    float upper[PatchMatrix::PanelSize];    ///< Upper bound of the lowest distance, one per panel lane.
+    std::vector<Candidate>* candidates;     ///< Shortlisted seeds, nullptr for the rows padding a block.
+};
+
+/**
+ * @brief Operands shared by the rows of a search.
+ */
+struct Operands
+{
+    unsigned int rowSize;       ///< Number of entries of a neighborhood.
+    unsigned int nbChannels;    ///< Number of channels.
+    unsigned int nbSeeds;       ///< Number of seeds, the last panel lanes above being padding.
+    float coefficient;          ///< Rounding error bound relative to the magnitude of a distance.
+};
+
+/**
+ * @brief Drop the shortlisted seeds that cannot be the closest given the current upper bounds.
+ */
+void compact(Row& row)
+{
+    const float upper = *std::min_element(row.upper, row.upper + PatchMatrix::PanelSize);
+    std::vector<Candidate>& candidates = *row.candidates;
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [upper](const Candidate& candidate)
+    {
+        return candidate.lower > upper;
+    }), candidates.end());
+}
+
+/**
+ * @brief Shortlist the lanes of a panel whose lower bound does not exceed the upper bound of their lane.
+ */
+inline void shortlistLanes(Row& row, const float* lower, unsigned int mask, unsigned int position, const Operands& operands)
+{
+    if (!row.candidates)
+        return;
+
+    for (unsigned int l = 0 ; l < PatchMatrix::PanelSize ; ++l)
+    {
+        if (((mask >> l) & 1) && position + l < operands.nbSeeds)
+            row.candidates->push_back({ position + l, lower[l] });
+    }
+
+    if (row.candidates->size() >= CompactionSize)
+        compact(row);
+}
+
+/// Scalar ///
+void panelScalar(const float* panel, Row* rows, unsigned int position, const Operands& operands)
+{
+    const unsigned int lanes = PatchMatrix::PanelSize;
+    const float* values = panel + lanes * operands.rowSize;
+    const float* norms = values + lanes * operands.nbChannels;
+
+    for (unsigned int r = 0 ; r < BlockRows ; ++r)
+    {
+        Row& row = rows[r];
+        float lower[lanes];
+        unsigned int mask = 0;
+        for (unsigned int l = 0 ; l < lanes ; ++l)
+        {
+            float dot = 0;
+            for (unsigned int k = 0 ; k < operands.rowSize ; ++k)
+                dot += row.values[k] * panel[k * lanes + l];
+
+            // Same operations as the kernels, so that the term is the one they add
+            float term = 0;
+            if (row.term)
+            {
+                for (unsigned int ch = 0 ; ch < operands.nbChannels ; ++ch)
+                {
+                    const float value = values[ch * lanes + l];
+                    term += (row.term->count * value - 2 * row.term->sum[ch]) * value;
+                }
+                term += row.term->squaredSum;
+            }
+
+            const float distance = (row.norm + norms[l]) - 2 * dot + term;
+            const float margin = operands.coefficient * (row.norm + norms[l] + std::abs(term));
+            lower[l] = distance - margin;
+            row.upper[l] = std::min(row.upper[l], distance + margin);
+            if (lower[l] <= row.upper[l])
+                mask |= 1u << l;
+        }
+
+        if (mask)
+            shortlistLanes(row, lower, mask, position, operands);
+    }
+}
+
+#ifdef PATCHMATRIX_X86
+
+/// SSE 4.2 : a panel in two halves of 4 seeds ///
+TARGET_SSE42 void panelSSE42(const float* panel, Row* rows, unsigned int position, const Operands& operands)
+{
+    const unsigned int lanes = PatchMatrix::PanelSize;
+    const float* values = panel + lanes * operands.rowSize;
+    const float* norms = values + lanes * operands.nbChannels;
+
+    __m128 dots[BlockRows][2];
+    for (unsigned int r = 0 ; r < BlockRows ; ++r)
+        dots[r][0] = dots[r][1] = _mm_setzero_ps();
+
+    for (unsigned int k = 0 ; k < operands.rowSize ; ++k)
+    {
+        const __m128 low = _mm_loadu_ps(panel + k * lanes);
+        const __m128 high = _mm_loadu_ps(panel + k * lanes + 4);
+        for (unsigned int r = 0 ; r < BlockRows ; ++r)
+        {
+            const __m128 a = _mm_set1_ps(rows[r].values[k]);
+            dots[r][0] = _mm_add_ps(dots[r][0], _mm_mul_ps(a, low));
+            dots[r][1] = _mm_add_ps(dots[r][1], _mm_mul_ps(a, high));
+        }
+    }
+
+    const __m128 signMask = _mm_set1_ps(-0.f);
+    for (unsigned int r = 0 ; r < BlockRows ; ++r)
+    {
+        Row& row = rows[r];
+        float lower[lanes];
+        unsigned int mask = 0;
+        for (unsigned int h = 0 ; h < 2 ; ++h)
+        {
+            __m128 term = _mm_setzero_ps();
+            if (row.term)
+            {
+                for (unsigned int ch = 0 ; ch < operands.nbChannels ; ++ch)
+                {
+                    const __m128 value = _mm_loadu_ps(values + ch * lanes + 4 * h);
+                    const __m128 factor = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(row.term->count), value), _mm_set1_ps(2 * row.term->sum[ch]));
+                    term = _mm_add_ps(term, _mm_mul_ps(factor, value));
+                }
+                term = _mm_add_ps(term, _mm_set1_ps(row.term->squaredSum));
+            }
+
+            const __m128 norm = _mm_add_ps(_mm_set1_ps(row.norm), _mm_loadu_ps(norms + 4 * h));
+            const __m128 distance = _mm_add_ps(_mm_sub_ps(norm, _mm_mul_ps(_mm_set1_ps(2), dots[r][h])), term);
+            const __m128 margin = _mm_mul_ps(_mm_set1_ps(operands.coefficient), _mm_add_ps(norm, _mm_andnot_ps(signMask, term)));
+            const __m128 low = _mm_sub_ps(distance, margin);
+            const __m128 upper = _mm_min_ps(_mm_loadu_ps(row.upper + 4 * h), _mm_add_ps(distance, margin));
+            _mm_storeu_ps(row.upper + 4 * h, upper);
+            _mm_storeu_ps(lower + 4 * h, low);
+            mask |= unsigned(_mm_movemask_ps(_mm_cmple_ps(low, upper))) << (4 * h);
+        }
+
+        if (mask)
+            shortlistLanes(row, lower, mask, position, operands);
+    }
+}
+
+/// AVX2 : a panel of 8 seeds per instruction ///
+TARGET_AVX2 void panelAVX2(const float* panel, Row* rows, unsigned int position, const Operands& operands)
+{
+    const unsigned int lanes = PatchMatrix::PanelSize;
+    const float* values = panel + lanes * operands.rowSize;
+    const float* norms = values + lanes * operands.nbChannels;
+
+    __m256 dots[BlockRows];
+    for (unsigned int r = 0 ; r < BlockRows ; ++r)
+        dots[r] = _mm256_setzero_ps();
+
+    for (unsigned int k = 0 ; k < operands.rowSize ; ++k)
+    {
+        const __m256 b = _mm256_loadu_ps(panel + k * lanes);
+        for (unsigned int r = 0 ; r < BlockRows ; ++r)
+            dots[r] = _mm256_add_ps(dots[r], _mm256_mul_ps(_mm256_set1_ps(rows[r].values[k]), b));
+    }
+
+    const __m256 signMask = _mm256_set1_ps(-0.f);
+    const __m256 seedNorms = _mm256_loadu_ps(norms);
+    for (unsigned int r = 0 ; r < BlockRows ; ++r)
+    {
+        Row& row = rows[r];
+        __m256 term = _mm256_setzero_ps();
+        if (row.term)
+        {
+            for (unsigned int ch = 0 ; ch < operands.nbChannels ; ++ch)
+            {
+                const __m256 value = _mm256_loadu_ps(values + ch * lanes);
+                const __m256 factor = _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(row.term->count), value), _mm256_set1_ps(2 * row.term->sum[ch]));
+                term = _mm256_add_ps(term, _mm256_mul_ps(factor, value));
+            }
+            term = _mm256_add_ps(term, _mm256_set1_ps(row.term->squaredSum));
+        }
+
+        const __m256 norm = _mm256_add_ps(_mm256_set1_ps(row.norm), seedNorms);
+        const __m256 distance = _mm256_add_ps(_mm256_sub_ps(norm, _mm256_mul_ps(_mm256_set1_ps(2), dots[r])), term);
+        const __m256 margin = _mm256_mul_ps(_mm256_set1_ps(operands.coefficient), _mm256_add_ps(norm, _mm256_andnot_ps(signMask, term)));
+        const __m256 low = _mm256_sub_ps(distance, margin);
+        const __m256 upper = _mm256_min_ps(_mm256_loadu_ps(row.upper), _mm256_add_ps(distance, margin));
+        _mm256_storeu_ps(row.upper, upper);
+
+        const unsigned int mask = _mm256_movemask_ps(_mm256_cmp_ps(low, upper, _CMP_LE_OQ));
+        if (mask)
+        {
+            float lower[lanes];
+            _mm256_storeu_ps(lower, low);
+            shortlistLanes(row, lower, mask, position, operands);
+        }
+    }
+}
+
+#endif
+
+/// Dispatch ///
+void panelDispatch(PatchDistanceBase::InstructionSet instructionSet, const float* panel, Row* rows, unsigned int position, const Operands& operands)
+{
+    switch (instructionSet)
+    {
+#ifdef PATCHMATRIX_X86
+    case PatchDistanceBase::InstructionSet::AVX2:
+        panelAVX2(panel, rows, position, operands);
+        break;
+    case PatchDistanceBase::InstructionSet::SSE42:
+        panelSSE42(panel, rows, position, operands);
+        break;
+#endif
+    default:
+        panelScalar(panel, rows, position, operands);
+        break;
+    }
+}
+
+}
+
+PatchMatrix::PatchMatrix(unsigned int radius, unsigned int dimensions)
+    : m_deltas()
+    , m_nbChannels(1)
+    , m_rowSize(0)
+    , m_panelStride(0)
+    , m_panels()
+    , m_seeds()
+    , m_instructionSet(PatchDistanceBase::detectInstructionSet())
+{
+    // Raster order, center excluded, as the kernels
+    const int r = int(radius);
+    const int rz = dimensions == 3 ? r : 0;
+    for (int dz = -rz ; dz <= rz ; ++dz)
+    {
+        for (int dy = -r ; dy <= r ; ++dy)
+        {
+            for (int dx = -r ; dx <= r ; ++dx)
+            {
+                if (dx || dy || dz)
+                    m_deltas.push_back({ dx, dy, dz });
+            }
+        }
+    }
+}
+
+void PatchMatrix::assign(const CImg<>& image, const RunSet& seeds)
+{
+    const unsigned int lanes = PanelSize;
+    const unsigned int planeSize = image.width() * image.height() * image.depth();
+    m_nbChannels = image.spectrum();
+    m_rowSize = m_deltas.size() * m_nbChannels;
+    m_panelStride = lanes * (m_rowSize + m_nbChannels + 1);
+
+    std::vector<int> offsets;
+    for (unsigned int ch = 0 ; ch < m_nbChannels ; ++ch)
+    {
+        for (const Delta& delta : m_deltas)
+            offsets.push_back((delta.dz * image.height() + delta.dy) * image.width() + delta.dx + int(ch * planeSize));
+    }
+
+    m_seeds.clear();
+    m_seeds.reserve(seeds.size());
+    for (const RunSet::Run& run : seeds.runs())
+    {
+        for (unsigned int i = 0 ; i < run.count ; ++i)
+            m_seeds.push_back(run.first + i);
+    }
+
+    // Padding seeds are null with a huge norm
+    const std::size_t nbPanels = (m_seeds.size() + lanes - 1) / lanes;
+    m_panels.assign(nbPanels * m_panelStride, 0);
+    for (std::size_t s = 0 ; s < nbPanels * lanes ; ++s)
+    {
+        float* panel = m_panels.data() + (s / lanes) * m_panelStride;
+        const unsigned int l = s % lanes;
+        float* norms = panel + lanes * (m_rowSize + m_nbChannels);
+        if (s >= m_seeds.size())
+        {
+            norms[l] = PaddingNorm;
+            continue;
+        }
+
+        const float* center = image.data() + m_seeds[s];
+        float norm = 0;
+        for (unsigned int k = 0 ; k < m_rowSize ; ++k)
+        {
+            const float value = center[offsets[k]];
+            panel[k * lanes + l] = value;
+            norm += value * value;
+        }
+        for (unsigned int ch = 0 ; ch < m_nbChannels ; ++ch)
+            panel[(m_rowSize + ch) * lanes + l] = center[ch * planeSize];
+        norms[l] = norm;
+    }
+}
+
+void PatchMatrix::gather(const CImg<>& image, int x, int y, int z, float* row) const
+{
+    unsigned int k = 0;
+    for (unsigned int ch = 0 ; ch < m_nbChannels ; ++ch)
+    {
+        for (const Delta& delta : m_deltas)
+            row[k++] = image._atXYZ(x + delta.dx, y + delta.dy, z + delta.dz, ch);
+    }
+}
+
+void PatchMatrix::shortlist(const float* rows, const NonCausalTerm* terms, unsigned int count, std::vector<unsigned int>* shortlists) const
+{
+    // Both the expanded distance and the kernel sum entries and norms of magnitude ||a||^2 + ||b||^2 + |term| at
+    // most: (4 (n + 4)) epsilon of this magnitude bounds the gap between their results, n being the number of terms
+    const unsigned int nbTerms = m_rowSize + m_nbChannels;
+    const Operands operands = { m_rowSize, m_nbChannels, (unsigned int)m_seeds.size(), 4 * (nbTerms + 4) * FLT_EPSILON };
+
+    std::vector<Row> states(count);
+    std::vector< std::vector<Candidate> > candidates(count);
+    for (unsigned int r = 0 ; r < count ; ++r)
+    {
+        Row& state = states[r];
+        state.values = rows + std::size_t(r) * m_rowSize;
+        state.norm = 0;
+        for (unsigned int k = 0 ; k < m_rowSize ; ++k)
+            state.norm += state.values[k] * state.values[k];
+        state.term = terms ? terms + r : nullptr;
+        std::fill(state.upper, state.upper + PanelSize, std::numeric_limits<float>::max());
+        state.candidates = &candidates[r];
+    }
+
+    // Cache blocking: a chunk of panels is multiplied by every neighborhood before the next chunk is read
+    const std::size_t nbPanels = m_panels.size() / std::max(1u, m_panelStride);
+    const std::size_t chunkPanels = std::max<std::size_t>(1, ChunkFloats / std::max(1u, m_panelStride));
+    for (std::size_t chunk = 0 ; chunk < nbPanels ; chunk += chunkPanels)
+    {
+        const std::size_t chunkEnd = std::min(nbPanels, chunk + chunkPanels);
+        for (unsigned int r = 0 ; r < count ; r += BlockRows)
+        {
+            // The last block is padded with copies of its first row, shortlisting nothing
+            Row block[BlockRows];
+            for (unsigned int b = 0 ; b < BlockRows ; ++b)
+            {
+                if (r + b < count)
+                    block[b] = states[r + b];
+                else
+                {
+                    block[b] = states[r];
+                    block[b].candidates = nullptr;
+                }
+            }
+
+            for (std::size_t p = chunk ; p < chunkEnd ; ++p)
+                panelDispatch(m_instructionSet, m_panels.data() + p * m_panelStride, block, p * PanelSize, operands);
+
+            for (unsigned int b = 0 ; b < BlockRows && r + b < count ; ++b)
+                std::copy(block[b].upper, block[b].upper + PanelSize, states[r + b].upper);
+        }
+    }
+
+    for (unsigned int r = 0 ; r < count ; ++r)
+    {
+        compact(states[r]);
+        shortlists[r].clear();
+        for (const Candidate& candidate : candidates[r])
+            shortlists[r].push_back(candidate.position);
+    }
+}
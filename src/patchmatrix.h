@@ -0,0 +1,113 @@
+#ifndef PATCHMATRIX_H
+#define PATCHMATRIX_H
+
+#include <vector>
+
+#include "CImg.h"
+
+#include "patchdistance.h"
+#include "runset.h"
+
+using namespace cimg_library;
+
+/**
+ * @brief The PatchMatrix class Neighborhoods of a set of seeds stored as the rows of a matrix, with their squared
+ * norms, so that the distances between a block of neighborhoods a and every seed b are computed as
+ * ||a||^2 + ||b||^2 - 2 a.b by a cache-blocked matrix product.
+ *
+ * The expanded form does not round as the distance kernels do. A search therefore only shortlists the seeds whose
+ * distance may be the lowest, given a bound of the rounding errors of both computations: the caller scores the
+ * shortlisted seeds with the kernel, so that the closest seed is the one an exhaustive kernel search finds.
+ *
+ * Seeds are interleaved by panels of PanelSize seeds, each panel holding the neighborhood entries, the center values
+ * (for the non-causal term) and the squared norms of its seeds.
+ */
+class PatchMatrix
+{
+public:
+    static const unsigned int PanelSize = 8;        ///< Number of seeds interleaved in a panel.
+
+    using NonCausalTerm = PatchDistanceBase::NonCausalTerm;
+
+private:
+    /**
+     * @brief The Delta struct Position of a neighborhood pixel relative to the center.
+     */
+    struct Delta
+    {
+        int dx, dy, dz;
+    };
+
+    std::vector<Delta> m_deltas;        ///< Neighborhood pixels, in raster order, center excluded.
+    unsigned int m_nbChannels;          ///< Number of channels of the images.
+    unsigned int m_rowSize;             ///< Number of entries of a neighborhood, pixels times channels.
+    unsigned int m_panelStride;         ///< Number of floats of a panel.
+    std::vector<float> m_panels;        ///< Interleaved seed neighborhoods, center values and squared norms.
+    std::vector<unsigned int> m_seeds;  ///< Linear index of every seed, in seed order.
+    PatchDistanceBase::InstructionSet m_instructionSet;    ///< Kernel implementation used.
+
+public:
+    /**
+     * @brief Constructor
+     * @param radius Radius of the neighborhoods.
+     * @param dimensions Number of dimensions of the neighborhoods, 2 or 3.
+     */
+    explicit PatchMatrix(unsigned int radius = 1, unsigned int dimensions = 2);
+
+    /**
+     * @brief Pack the neighborhoods of a set of seeds.
+     * @param image Image the neighborhoods are read from.
+     * @param seeds Linear indices of the seeds, lying at least the radius away from the border.
+     */
+    void assign(const CImg<>& image, const RunSet& seeds);
+
+    /**
+     * @brief Get the number of entries of a neighborhood.
+     * @return Number of floats of a row given to shortlist.
+     */
+    unsigned int rowSize() const
+    {
+        return m_rowSize;
+    }
+
+    /**
+     * @brief Get the number of seeds.
+     * @return Number of seeds.
+     */
+    std::size_t size() const
+    {
+        return m_seeds.size();
+    }
+
+    /**
+     * @brief Get the linear index of a seed.
+     * @param position Position of the seed.
+     * @return Linear index.
+     */
+    unsigned int seed(std::size_t position) const
+    {
+        return m_seeds[position];
+    }
+
+    /**
+     * @brief Copy the neighborhood of a pixel as a row, channel after channel in raster order. Coordinates outside
+     * the image are clamped.
+     * @param image Image.
+     * @param x x coordinate of the pixel.
+     * @param y y coordinate of the pixel.
+     * @param z z coordinate of the pixel.
+     * @param row Output row of rowSize() floats.
+     */
+    void gather(const CImg<>& image, int x, int y, int z, float* row) const;
+
+    /**
+     * @brief Shortlist, for each of a block of neighborhoods, the seeds that may be the closest one.
+     * @param rows Neighborhoods given by gather, rowSize() floats each.
+     * @param terms Non-causal term added to the distance of each neighborhood, nullptr if there is none.
+     * @param count Number of neighborhoods.
+     * @param shortlists Output positions of the shortlisted seeds of each neighborhood, in increasing order.
+     */
+    void shortlist(const float* rows, const NonCausalTerm* terms, unsigned int count, std::vector<unsigned int>* shortlists) const;
+};
+
+#endif // PATCHMATRIX_H
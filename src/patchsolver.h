@@ -0,0 +1,432 @@
+#ifndef PATCHSOLVER_H
+#define PATCHSOLVER_H
+
+#include "abstractalgorithm.h"
+#include "patchdistance.h"
+#include "runset.h"
+#include "solverpolicies.h"
+
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+/**
+ * @brief The PatchSolver class Replaces every mask pixel by the candidate pixel of lowest energy, iteration after
+ * iteration, for any combination of policies.
+ *
+ * The candidate policy chooses the pixels searched (GlobalCandidates, WindowCandidates), the energy policy the terms
+ * added to the neighborhood distance (CausalEnergy, NonCausalEnergy) and the kernel the patch geometry and its
+ * vectorized search (BasicPatchDistance of any radius). Every combination is compiled separately, so that the per-candidate code is
+ * fully inlined. Volumes are solved by the kernels of 3D neighborhoods, mask pixels being voxels.
+ */
+template<class CandidatePolicy, class EnergyPolicy, class Kernel = PatchDistance>
+class PatchSolver
+    : public AbstractAlgorithm
+{
+public:
+    // Data structure defines
+    using IndexSet = std::vector< unsigned int >;
+    using MaskSet = IndexSet;
+    using Query = BlockQuery<Kernel, EnergyPolicy>;
+
+    /**
+     * @brief The Traversal enum Enumerate the orders in which mask pixels are updated.
+     */
+    enum class Traversal
+    {
+        ROWS,       ///< Row by row, slice by slice.
+        COLUMNS,    ///< Column by column, slice by slice.
+    };
+
+    /**
+     * @brief The InitialPixels enum Enumerate the sets the random initialization picks pixels from.
+     */
+    enum class InitialPixels
+    {
+        KNOWN,      ///< Every pixel out the mask.
+        CANDIDATES, ///< Pixels out the mask having a full neighborhood.
+    };
+
+protected:
+    MaskSet m_mask;         ///< Linear index of the pixels that are in the mask, in traversal order.
+    IndexSet m_matches;     ///< Linear index of the pixel replacing each mask pixel.
+
+    CandidatePolicy m_candidates;   ///< Pixels searched.
+    Kernel m_patchDistance;         ///< Neighborhood distance kernel.
+    bool m_batchedSearch;           ///< Search blocks of mask pixels at once during Jacobi sweeps.
+    bool m_seedTree;                ///< Build the k-d tree of the candidates before the first iteration.
+    double m_treeApproximation;     ///< Tolerated relative excess of the distances found through the tree.
+
+    /**
+     * @brief Recover all pixels coordinates that need reconstruction.
+     * @param traversal Order of the mask pixels.
+     */
+    void computeMask(Traversal traversal);
+
+    /**
+     * @brief Initialize all pixel from mask to a random value from input image.
+     * @param initialPixels Pixels the values are picked from.
+     */
+    void randomInitMask(InitialPixels initialPixels);
+
+    /**
+     * @brief Gather what the search of a mask pixel needs: its neighborhood, its energy term and the distance of its
+     * current correspondence.
+     * @param n Index of the pixel in the mask.
+     * @param source Image the neighborhood of the pixel is read from.
+     * @param candidates Image the neighborhoods of the candidates are read from.
+     * @param query Output query.
+     */
+    void prepareQuery(std::size_t n, const CImg<>& source, const CImg<>& candidates, Query& query) const;
+
+    /**
+     * @brief Replace a mask pixel by the candidate having the lowest energy.
+     * @param n Index of the pixel in the mask.
+     * @param source Image the neighborhood of the pixel is read from.
+     * @param candidates Image the neighborhoods of the candidates are read from.
+     * @return Energy of the chosen candidate, 0 if the pixel has none.
+     */
+    double updatePixel(std::size_t n, const CImg<>& source, const CImg<>& candidates);
+
+    /**
+     * @brief Replace a block of consecutive mask pixels by their candidates having the lowest energy, searched together.
+     * @param begin Index of the first pixel in the mask.
+     * @param end Index past the last pixel in the mask.
+     * @param source Image the neighborhoods are read from, different from the image updated.
+     * @return Sum of the energies of the chosen candidates, in mask order.
+     */
+    double updateBlock(std::size_t begin, std::size_t end, const CImg<>& source);
+
+    /**
+     * @brief Jacobi sweep updating the mask pixels block by block, with the result of a pixel by pixel Jacobi sweep.
+     * @return Energy of the iteration.
+     */
+    double sweepBlocks();
+
+public:
+    /**
+     * @brief Constructor
+     * @param input Image that will be treated.
+     * @param candidates Candidate policy.
+     * @param traversal Order of the mask pixels.
+     * @param initialPixels Pixels the random initialization picks values from.
+     * @param nbIteration Number of iterations to perform.
+     * @param prematureStop Flag for premature stop.
+     * @param windowsSize Window size.
+     * @param gapPercentage Gap percentage to use.
+     * @param verbose Use verbose mode.
+     * @param produceStats Algorithm will produce file for statistics.
+     * @param seed Seed of the random generator.
+     */
+    PatchSolver(CImg<> input,
+                CandidatePolicy candidates,
+                Traversal traversal,
+                InitialPixels initialPixels,
+                unsigned int nbIteration = 5,
+                bool prematureStop = true,
+                unsigned int windowSize = 10,
+                double gapPercentage = 0.01,
+                bool verbose = false,
+                bool produceStats = false,
+                unsigned int seed = DefaultSeed);
+
+    /**
+     * @brief Update the mask pixels until the iterations are done or the energy settles.
+     */
+    void exec() override;
+
+    /**
+     * @brief Get batched search state.
+     * @return True if Jacobi sweeps search blocks of mask pixels at once.
+     */
+    bool batchedSearch() const
+    {
+        return m_batchedSearch;
+    }
+
+    /**
+     * @brief Enable or disable batched search, disabled by default. Blocks are only searched during Jacobi sweeps
+     * without dirty scheduling, as every pixel of a block must read the same image.
+     * @param state Batched search state.
+     */
+    void setBatchedSearch(bool state)
+    {
+        m_batchedSearch = state;
+    }
+
+    /**
+     * @brief Get seed tree state.
+     * @return True if the k-d tree of the candidates is built before the first iteration.
+     */
+    bool seedTree() const
+    {
+        return m_seedTree;
+    }
+
+    /**
+     * @brief Enable or disable the seed tree, disabled by default. The candidates whose
+     * neighborhood lies out the mask are stored in a k-d tree, the others being searched exhaustively.
+     * @param state Seed tree state.
+     */
+    void setSeedTree(bool state)
+    {
+        m_seedTree = state;
+    }
+
+    /**
+     * @brief Get the approximation of the searches through the seed tree.
+     * @return Epsilon, 0 for exact searches.
+     */
+    double treeApproximation() const
+    {
+        return m_treeApproximation;
+    }
+
+    /**
+     * @brief Set the approximation of the searches through the seed tree, 0 by default. The candidates found are at
+     * most 1 + epsilon times farther than the closest ones.
+     * @param epsilon Tolerated relative excess of the distances found.
+     */
+    void setTreeApproximation(double epsilon)
+    {
+        m_treeApproximation = epsilon;
+    }
+
+    /**
+     * @brief Get the candidate policy.
+     * @return Candidate policy.
+     */
+    const CandidatePolicy& candidates() const
+    {
+        return m_candidates;
+    }
+};
+
+template<class CandidatePolicy, class EnergyPolicy, class Kernel>
+PatchSolver<CandidatePolicy, EnergyPolicy, Kernel>::PatchSolver(CImg<> input,
+                                                                CandidatePolicy candidates,
+                                                                Traversal traversal,
+                                                                InitialPixels initialPixels,
+                                                                unsigned int nbIteration,
+                                                                bool prematureStop,
+                                                                unsigned int windowSize,
+                                                                double gapPercentage,
+                                                                bool verbose,
+                                                                bool produceStats,
+                                                                unsigned int seed)
+    : AbstractAlgorithm(input, nbIteration, prematureStop, windowSize, gapPercentage, verbose, produceStats, seed)
+    , m_candidates(candidates)
+    , m_patchDistance(input.width(), input.height(), input.depth(), input.spectrum())
+    , m_batchedSearch(false)
+    , m_seedTree(false)
+    , m_treeApproximation(0)
+{
+    setPatchRadius(Kernel::PatchRadius);
+    computeMask(traversal);
+    m_candidates.initialize(m_image, m_inMask, Kernel::PatchRadius);
+    randomInitMask(initialPixels);
+}
+
+template<class CandidatePolicy, class EnergyPolicy, class Kernel>
+void PatchSolver<CandidatePolicy, EnergyPolicy, Kernel>::computeMask(Traversal traversal)
+{
+    const auto add = [this](unsigned int x, unsigned int y, unsigned int z)
+    {
+        // Blank pixels
+        if (m_inMask(x, y, z))
+        {
+            setPixelColor(m_mask.size(), x, y, z);
+            m_mask.push_back(m_image.offset(x, y, z));
+        }
+    };
+
+    // Add every pixels in the image that should be reconstructed, in traversal order
+    if (traversal == Traversal::ROWS)
+    {
+        cimg_forXYZ(m_image, x, y, z)
+            add(x, y, z);
+    }
+    else
+    {
+        cimg_forZ(m_image, z)
+            cimg_forX(m_image, x)
+                cimg_forY(m_image, y)
+                    add(x, y, z);
+    }
+
+    if (m_verbose)
+    {
+        std::cout << "Taille masque : " << m_mask.size() << std::endl;
+    }
+}
+
+template<class CandidatePolicy, class EnergyPolicy, class Kernel>
+void PatchSolver<CandidatePolicy, EnergyPolicy, Kernel>::randomInitMask(InitialPixels initialPixels)
+{
+    const int r = Kernel::PatchRadius;
+    const int rz = m_image.depth() > 1 ? r : 0;
+    const bool known = initialPixels == InitialPixels::KNOWN;
+
+    // Runs of pixels out the mask along the rows, a few bytes per row even on large volumes
+    RunSet pixels;
+    cimg_forYZ(m_image, y, z)
+    {
+        if (!known && (y < r || y >= m_image.height() - r || z < rz || z >= m_image.depth() - rz))
+            continue;
+
+        pixels.addUnmasked(m_inMask, known ? 0 : r, known ? m_image.width() : m_image.width() - r, y, z);
+    }
+
+    if (pixels.size() == 0 && !m_mask.empty())
+    {
+        throw CImgArgumentException("No pixel out the mask%s to initialize the mask pixels from.",
+                                    known ? "" : " has a full neighborhood");
+    }
+
+    // Initialize the color of every mask pixel to a random pixel color in the seed image
+    m_matches.resize(m_mask.size());
+    for (std::size_t n = 0 ; n < m_mask.size() ; ++n)
+    {
+        const unsigned int index = pixels.at(m_random() % pixels.size());
+        m_matches[n] = index;
+        copyPixel(m_mask[n], m_image, index);
+    }
+}
+
+template<class CandidatePolicy, class EnergyPolicy, class Kernel>
+void PatchSolver<CandidatePolicy, EnergyPolicy, Kernel>::prepareQuery(std::size_t n, const CImg<>& source, const CImg<>& candidates,
+                                                                      Query& query) const
+{
+    const unsigned int offset = m_mask[n];
+    query.x = offset % m_image.width();
+    query.y = (offset / m_image.width()) % m_image.height();
+    query.z = offset / (m_image.width() * m_image.height());
+
+    m_patchDistance.gather(source, query.x, query.y, query.z, query.patch);
+    query.term = EnergyPolicy::term(m_patchDistance, source, m_inMask, query.x, query.y, query.z);
+
+    // The current correspondence bounds the search if it is one of the candidates (it may not be after the random
+    // initialization): only closer candidates need a complete distance
+    const unsigned int match = m_matches[n];
+    query.bound = m_candidates.contains(m_inMask, query.x, query.y, query.z, match)
+            ? EnergyPolicy::distance(m_patchDistance, candidates.data(), query.patch, query.term, match)
+            : std::numeric_limits<float>::max();
+    query.bestIndex = 0;
+    query.distance = 0;
+}
+
+template<class CandidatePolicy, class EnergyPolicy, class Kernel>
+double PatchSolver<CandidatePolicy, EnergyPolicy, Kernel>::updatePixel(std::size_t n, const CImg<>& source, const CImg<>& candidates)
+{
+    Query query;
+    prepareQuery(n, source, candidates, query);
+
+    typename Kernel::Statistics statistics = { 0, 0 };
+    query.distance = m_candidates.template search<EnergyPolicy>(m_patchDistance, candidates, query.patch, query.term,
+                                                                query.x, query.y, query.z, query.bound,
+                                                                query.bestIndex, statistics);
+    addStatistics(statistics);
+
+    // A pixel without any candidate keeps its value and its correspondence, and stays out of the energy
+    if (query.distance >= std::numeric_limits<float>::max())
+        return 0;
+
+    // Set new pixel color and update the correspondence
+    m_matches[n] = query.bestIndex;
+    copyPixel(m_mask[n], candidates, query.bestIndex);
+
+    return query.distance;
+}
+
+template<class CandidatePolicy, class EnergyPolicy, class Kernel>
+double PatchSolver<CandidatePolicy, EnergyPolicy, Kernel>::updateBlock(std::size_t begin, std::size_t end, const CImg<>& source)
+{
+    std::vector<Query> queries(end - begin);
+    for (std::size_t n = begin ; n < end ; ++n)
+        prepareQuery(n, source, source, queries[n - begin]);
+
+    typename Kernel::Statistics statistics = { 0, 0 };
+    m_candidates.template searchBlock<EnergyPolicy>(m_patchDistance, source, queries.data(), queries.size(), statistics);
+    addStatistics(statistics);
+
+    // Energies are summed in the order a pixel by pixel sweep sums them
+    double energy = 0;
+    for (std::size_t n = begin ; n < end ; ++n)
+    {
+        const Query& query = queries[n - begin];
+        if (query.distance >= std::numeric_limits<float>::max())
+            continue;
+
+        m_matches[n] = query.bestIndex;
+        copyPixel(m_mask[n], source, query.bestIndex);
+        energy += query.distance;
+    }
+
+    return energy;
+}
+
+template<class CandidatePolicy, class EnergyPolicy, class Kernel>
+double PatchSolver<CandidatePolicy, EnergyPolicy, Kernel>::sweepBlocks()
+{
+    const CImg<>& source = freezeImage();
+    m_candidates.prepareBlocks(source);
+
+    const std::size_t nbBlocks = (m_mask.size() + SweepBlockSize - 1) / SweepBlockSize;
+    std::vector<double> energies(nbBlocks, 0);
+    threadPool().run(nbBlocks, [&](std::size_t block)
+    {
+        const std::size_t begin = block * SweepBlockSize;
+        energies[block] = updateBlock(begin, std::min(m_mask.size(), begin + SweepBlockSize), source);
+    });
+
+    return std::accumulate(energies.begin(), energies.end(), 0.0);
+}
+
+template<class CandidatePolicy, class EnergyPolicy, class Kernel>
+void PatchSolver<CandidatePolicy, EnergyPolicy, Kernel>::exec()
+{
+    double lastEnergy = std::numeric_limits<double>::max();
+
+    if (m_seedTree)
+        m_candidates.buildTree(m_image, m_inMask, m_treeApproximation);
+
+    bool end = false;
+    unsigned int i = 0;
+    while (!end && i < m_nbIterations)
+    {
+        const bool blocks = m_batchedSearch && sweepMode() == SweepMode::JACOBI && !dirtyScheduling();
+        const double energy = blocks ? sweepBlocks() : sweep(m_mask.size(), [this](std::size_t n, const CImg<>& source, const CImg<>& candidates)
+        {
+            return updatePixel(n, source, candidates);
+        }, m_matches.data());
+        const double pruningRate = endIteration(energy);
+
+        // Iteration results
+        double ratio = (lastEnergy - energy) / double(lastEnergy);
+        ratio = ratio > 0 ? ratio : -ratio;
+
+        // Verbose
+        if (m_verbose)
+        {
+            std::cout << "Loop : " << i << "\nLast Energy : " << lastEnergy << "\nEnergy : " << energy << "\nRatio : " << ratio << "\nPruning rate : " << pruningRate << "\n" << std::endl;
+        }
+
+        lastEnergy = energy;
+
+        if (m_enablePrematureStop && computePrematureStop(energy))
+        {
+            if (m_verbose)
+            {
+                std::cout << "Algorithm prematuraly stopped at iteration: " << i << std::endl;
+            }
+
+            end = true;
+        }
+
+        ++i;
+    }
+}
+
+#endif // PATCHSOLVER_H
@@ -1,51 +1,18 @@
 #ifndef PROBABILISTICALGORITHM_H
 #define PROBABILISTICALGORITHM_H
 
-#include "abstractalgorithm.h"
-
-#include <vector>
-#include <map>
+#include "patchsolver.h"
 
 /**
- * @brief The DeterministicAlgorithm class Implements the deterministic method.
+ * @brief The BasicProbabilisticAlgorithm class Implements the probabilistic method: every seed pixel is searched, on the neighborhood distance plus the non-causal term.
  */
-class ProbabilisticAlgorithm
-    : public AbstractAlgorithm
+template<unsigned int Radius, unsigned int Dimensions = 2>
+class BasicProbabilisticAlgorithm
+    : public PatchSolver<GlobalCandidates, NonCausalEnergy, BasicPatchDistance<Radius, Dimensions>>
 {
 public:
-    // Data structure defines
-    using Point = std::pair< unsigned int, unsigned int >;
-    using PointSet = std::vector< Point >;
-    using MapMask = std::map<Point, Point>;
-    using MaskSet = std::map< Point, PointSet >;
-
-private:
-    MapMask m_mappingMask;			///< Association of the pixel which are in the mask with the replacing pixels.
-    //MaskSet m_neighboorhoodMap;		///< Pixel that are in the mask with their neighboorhood.
-    PointSet m_outMask;				///< Pixel that are out the mask.
-
-    /**
-     * @brief Recover all pixels coordinates that need reconstruction.
-     */
-    void computeMask();
-
-    /**
-     * @brief Initialize all pixel from mask to a random value from input image.
-     */
-    void randomInitMask();
+    using Solver = PatchSolver<GlobalCandidates, NonCausalEnergy, BasicPatchDistance<Radius, Dimensions>>;
 
-    /**
-     * @brief Help to compute the non causal part of the probabilty distance
-     * @param value Value of the pixel analyzed
-     * @param xA x coordinate of the pixel replaced
-     * @param yA y coordinate of the pixel replaced
-     * @param xB x coordinate of the neighboor chosen
-     * @param yB y coordinate of the neighboor chosen
-     * @return the distance between the pixels.
-     */
-    double distanceNonCausal(float value, int xA, int yA, int xB, int yB);
-
-public:
     /**
      * @brief Constructor
      * @param input Image that will be treated.
@@ -55,19 +22,19 @@ public:
      * @param gapPercentage Gap percentage to use.
      * @param verbose Use verbose mode.
      * @param produceStats Algorithm will produce file for statistics.
+     * @param seed Seed of the random generator.
      */
-    ProbabilisticAlgorithm(CImg<> input,
-                           unsigned int nbIteration = 5,
-                           bool prematureStop = true,
-                           unsigned int windowSize = 10,
-                           double gapPercentage = 0.01,
-                           bool verbose = false,
-                           bool produceStats = false);
-
-    /**
-     * @brief Use the probabilistic method to emplace mask pixels.
-     */
-    void exec() override;
+    BasicProbabilisticAlgorithm(CImg<> input,
+                                unsigned int nbIteration = 5,
+                                bool prematureStop = true,
+                                unsigned int windowSize = 10,
+                                double gapPercentage = 0.01,
+                                bool verbose = false,
+                                bool produceStats = false,
+                                unsigned int seed = DefaultSeed);
 };
 
+/// BasicProbabilisticAlgorithm on 3x3 neighborhoods.
+using ProbabilisticAlgorithm = BasicProbabilisticAlgorithm<1>;
+
 #endif // PROBABILISTICALGORITHM_H
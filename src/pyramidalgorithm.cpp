@@ -0,0 +1,78 @@
+#include "pyramidalgorithm.h"
+
+#include <iostream>
+
+PyramidAlgorithm::PyramidAlgorithm(CImg<> input,
+                                   AlgorithmFactory factory,
+                                   unsigned int nbLevels,
+                                   bool verbose,
+                                   unsigned int seed)
+    : AbstractAlgorithm(input, 1, false, 10, 0.01, verbose, false, seed)
+    , m_factory(factory)
+    , m_nbLevels(std::max(1u, nbLevels))
+{
+
+}
+
+std::vector< CImg<> > PyramidAlgorithm::computeLevels() const
+{
+    std::vector< CImg<> > levels(1, m_image);
+    CImg<> mask(m_inMask);
+
+    while (levels.size() < m_nbLevels)
+    {
+        const CImg<>& fine = levels.back();
+        const int width = (fine.width() + 1) / 2;
+        const int height = (fine.height() + 1) / 2;
+        if (width < MinLevelSize || height < MinLevelSize)
+            break;
+
+        // Any-masked downsampling: a coarse pixel is in the mask if one of its fine pixels is
+        mask.resize(width, height, 1, 1, 2);
+        CImg<> coarse = fine.get_resize(width, height, 1, -100, 2);
+
+        bool hasSeed = false;
+        cimg_forXY(coarse, x, y)
+        {
+            if (mask(x, y) > 0)
+            {
+                cimg_forC(coarse, c)
+                    coarse(x, y, 0, c) = 255;
+            }
+            else if (x > 0 && y > 0 && x < width - 1 && y < height - 1)
+                hasSeed = true;
+        }
+
+        // A level needs pixels to copy from
+        if (!hasSeed)
+            break;
+
+        levels.push_back(coarse);
+    }
+
+    return levels;
+}
+
+void PyramidAlgorithm::exec()
+{
+    const std::vector< CImg<> > levels = computeLevels();
+
+    CImg<> guess;
+    for (std::size_t l = levels.size() ; l-- > 0 ; )
+    {
+        const CImg<>& level = levels[l];
+        if (m_verbose)
+        {
+            std::cout << "Level : " << l << " (" << level.width() << "x" << level.height() << ")" << std::endl;
+        }
+
+        std::unique_ptr<AbstractAlgorithm> algorithm = m_factory(level, seed());
+        if (!guess.is_empty())
+            algorithm->initialize(guess.resize(level.width(), level.height(), 1, -100, 3));
+
+        algorithm->exec();
+        guess = algorithm->getResult();
+    }
+
+    m_image = guess;
+}
@@ -0,0 +1,70 @@
+#ifndef PYRAMIDALGORITHM_H
+#define PYRAMIDALGORITHM_H
+
+#include "abstractalgorithm.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief The PyramidAlgorithm class Runs an algorithm from coarse to fine resolutions.
+ *
+ * The image and its mask are halved level after level, a coarse pixel being in the mask if any of its fine pixels
+ * is. The coarsest level is solved from a random initialization, then the result of each level is upsampled to
+ * initialize the mask pixels of the next one.
+ */
+class PyramidAlgorithm
+    : public AbstractAlgorithm
+{
+public:
+    /**
+     * @brief Function creating the algorithm solving one level from its input image and the seed of its random
+     * generator.
+     */
+    using AlgorithmFactory = std::function<std::unique_ptr<AbstractAlgorithm>(const CImg<>&, unsigned int)>;
+
+    static const int MinLevelSize = 16;  ///< Minimum width and height of a level.
+
+private:
+    AlgorithmFactory m_factory;     ///< Creation of the algorithm solving a level.
+    unsigned int m_nbLevels;        ///< Maximum number of levels, the full resolution included.
+
+    /**
+     * @brief Compute the input images of the levels, from the finest to the coarsest.
+     * @return Input images, mask pixels having the value 255.
+     */
+    std::vector< CImg<> > computeLevels() const;
+
+public:
+    /**
+     * @brief Constructor
+     * @param input Image that will be treated.
+     * @param factory Creation of the algorithm solving a level.
+     * @param nbLevels Maximum number of levels, the full resolution included. Fewer levels are used if the image
+     * becomes too small or fully masked.
+     * @param verbose Use verbose mode.
+     * @param seed Seed of the random generator of every level.
+     */
+    PyramidAlgorithm(CImg<> input,
+                     AlgorithmFactory factory,
+                     unsigned int nbLevels = 4,
+                     bool verbose = false,
+                     unsigned int seed = DefaultSeed);
+
+    /**
+     * @brief Solve every level from the coarsest to the full resolution.
+     */
+    void exec() override;
+
+    /**
+     * @brief Get the maximum number of levels.
+     * @return Number of levels.
+     */
+    unsigned int nbLevels() const
+    {
+        return m_nbLevels;
+    }
+};
+
+#endif // PYRAMIDALGORITHM_H
@@ -3,6 +3,6 @@
 
 #include <random>
 
-static std::mt19937 mt(123456789); ///< Random generator.
+static const unsigned int DefaultSeed = 123456789; ///< Seed of the random generators, one per algorithm.
 
 #endif // RANDOM_H
@@ -0,0 +1,36 @@
+#include "runset.h"
+
+#include <algorithm>
+
+void RunSet::add(unsigned int first, unsigned int count)
+{
+    if (count == 0)
+        return;
+
+    m_runs.push_back({ first, count });
+    m_ends.push_back(size() + count);
+}
+
+void RunSet::addUnmasked(const CImg<bool>& inMask, int beginX, int endX, int y, int z)
+{
+    int x = beginX;
+    while (x < endX)
+    {
+        const int first = x;
+        while (x < endX && !inMask(x, y, z))
+            ++x;
+        add(inMask.offset(first, y, z), x - first);
+
+        while (x < endX && inMask(x, y, z))
+            ++x;
+    }
+}
+
+unsigned int RunSet::at(std::size_t i) const
+{
+    // First run ending after the rank
+    const std::size_t r = std::upper_bound(m_ends.begin(), m_ends.end(), i) - m_ends.begin();
+    const std::size_t begin = r ? m_ends[r - 1] : 0;
+
+    return m_runs[r].first + (i - begin);
+}
@@ -0,0 +1,86 @@
+#ifndef RUNSET_H
+#define RUNSET_H
+
+#include <cstddef>
+#include <vector>
+
+#include "CImg.h"
+
+using namespace cimg_library;
+
+/**
+ * @brief The RunSet class Ordered set of linear indices stored as runs of consecutive indices.
+ *
+ * Pixels out the mask form long runs along the rows, so that a set of pixels costs a few bytes per row instead of
+ * four bytes per pixel, and the searches can load the neighborhoods of a run without gathering.
+ */
+class RunSet
+{
+public:
+    /**
+     * @brief The Run struct Consecutive linear indices.
+     */
+    struct Run
+    {
+        unsigned int first;     ///< First linear index.
+        unsigned int count;     ///< Number of indices.
+    };
+
+private:
+    std::vector<Run> m_runs;            ///< Runs, in increasing index order.
+    std::vector<std::size_t> m_ends;    ///< Number of indices in the runs up to each one, included.
+
+public:
+    /**
+     * @brief Add a run after the last one.
+     * @param first First linear index, greater than the indices of the set.
+     * @param count Number of indices, empty runs are ignored.
+     */
+    void add(unsigned int first, unsigned int count);
+
+    /**
+     * @brief Add the runs of pixels out the mask of a segment of row, after the last run.
+     * @param inMask Flag image (or volume) of the mask pixels.
+     * @param beginX First x coordinate of the segment.
+     * @param endX x coordinate following the segment.
+     * @param y y coordinate of the row.
+     * @param z z coordinate of the row.
+     */
+    void addUnmasked(const CImg<bool>& inMask, int beginX, int endX, int y, int z);
+
+    /**
+     * @brief Get an index of the set, in O(log runs).
+     * @param i Rank of the index, lower than size().
+     * @return Linear index.
+     */
+    unsigned int at(std::size_t i) const;
+
+    /**
+     * @brief Get the number of indices.
+     * @return Number of indices.
+     */
+    std::size_t size() const
+    {
+        return m_ends.empty() ? 0 : m_ends.back();
+    }
+
+    /**
+     * @brief Get the runs.
+     * @return Runs, in increasing index order.
+     */
+    const std::vector<Run>& runs() const
+    {
+        return m_runs;
+    }
+
+    /**
+     * @brief Remove every run.
+     */
+    void clear()
+    {
+        m_runs.clear();
+        m_ends.clear();
+    }
+};
+
+#endif // RUNSET_H
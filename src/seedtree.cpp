@@ -0,0 +1,237 @@
+#include "seedtree.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+SeedTree::SeedTree(unsigned int radius, unsigned int dimensions)
+    : m_deltas()
+    , m_entryOffsets()
+    , m_nbChannels(1)
+    , m_entrySize(1)
+    , m_boxStride(4)
+    , m_nodes()
+    , m_boxes()
+    , m_seeds()
+    , m_boundary()
+    , m_maxValue(0)
+    , m_relativeError(0)
+    , m_approximation(0)
+{
+    const int r = int(radius);
+    const int rz = dimensions == 3 ? r : 0;
+    for (int dz = -rz ; dz <= rz ; ++dz)
+    {
+        for (int dy = -r ; dy <= r ; ++dy)
+        {
+            for (int dx = -r ; dx <= r ; ++dx)
+            {
+                if (dx || dy || dz)
+                    m_deltas.push_back({ dx, dy, dz });
+            }
+        }
+    }
+}
+
+void SeedTree::assign(const CImg<>& image, const CImg<bool>& inMask, const RunSet& seeds)
+{
+    const unsigned int planeSize = image.width() * image.height() * image.depth();
+    m_nbChannels = std::min<unsigned int>(image.spectrum(), PatchDistanceBase::MaxChannels);
+    m_entrySize = m_deltas.size() * m_nbChannels;
+    m_boxStride = 2 * (m_entrySize + m_nbChannels);
+
+    std::vector<int> offsets;
+    for (const Delta& delta : m_deltas)
+        offsets.push_back((delta.dz * image.height() + delta.dy) * image.width() + delta.dx);
+
+    // Entries are looked up by offset, as the kernels sort them by deviation
+    m_entryOffsets.clear();
+    for (unsigned int ch = 0 ; ch < m_nbChannels ; ++ch)
+    {
+        for (unsigned int k = 0 ; k < m_deltas.size() ; ++k)
+            m_entryOffsets.push_back({ offsets[k] + int(ch * planeSize), ch * (unsigned int)m_deltas.size() + k });
+    }
+    std::sort(m_entryOffsets.begin(), m_entryOffsets.end());
+
+    std::vector<unsigned int> indexed;
+    splitBoundary(inMask, offsets, seeds, m_boundary, indexed);
+
+    // Points hold the neighborhood entries channel after channel, then the center values
+    const unsigned int pointSize = m_entrySize + m_nbChannels;
+    std::vector<float> points(indexed.size() * pointSize);
+    m_maxValue = 0;
+    for (std::size_t i = 0 ; i < indexed.size() ; ++i)
+    {
+        float* point = points.data() + i * pointSize;
+        for (unsigned int ch = 0 ; ch < m_nbChannels ; ++ch)
+        {
+            const float* center = image.data() + indexed[i] + ch * planeSize;
+            for (unsigned int k = 0 ; k < m_deltas.size() ; ++k)
+                point[ch * m_deltas.size() + k] = center[offsets[k]];
+            point[m_entrySize + ch] = *center;
+            m_maxValue = std::max(m_maxValue, double(std::abs(*center)));
+        }
+    }
+
+    // Nodes are split in creation order, so that their boxes are appended in node order
+    std::vector<unsigned int> order(indexed.size());
+    std::iota(order.begin(), order.end(), 0);
+    m_nodes.clear();
+    m_boxes.clear();
+    if (!order.empty())
+        m_nodes.push_back({ 0, order.size(), 0 });
+    for (std::size_t n = 0 ; n < m_nodes.size() ; ++n)
+    {
+        const std::size_t begin = m_nodes[n].begin;
+        const std::size_t end = m_nodes[n].end;
+        const std::size_t box = m_boxes.size();
+        m_boxes.insert(m_boxes.end(), points.begin() + order[begin] * pointSize, points.begin() + (order[begin] + 1) * pointSize);
+        m_boxes.insert(m_boxes.end(), points.begin() + order[begin] * pointSize, points.begin() + (order[begin] + 1) * pointSize);
+        float* low = m_boxes.data() + box;
+        float* high = low + pointSize;
+        for (std::size_t p = begin + 1 ; p < end ; ++p)
+        {
+            const float* point = points.data() + order[p] * pointSize;
+            for (unsigned int d = 0 ; d < pointSize ; ++d)
+            {
+                low[d] = std::min(low[d], point[d]);
+                high[d] = std::max(high[d], point[d]);
+            }
+        }
+
+        // Only the neighborhood entries are split, the centers are only bounded
+        unsigned int widest = 0;
+        for (unsigned int d = 1 ; d < m_entrySize ; ++d)
+        {
+            if (high[d] - low[d] > high[widest] - low[widest])
+                widest = d;
+        }
+
+        if (end - begin <= LeafSize || high[widest] == low[widest])
+        {
+            std::sort(order.begin() + begin, order.begin() + end);
+            continue;
+        }
+
+        const std::size_t middle = begin + (end - begin) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end, [&](unsigned int a, unsigned int b)
+        {
+            return points[a * pointSize + widest] < points[b * pointSize + widest];
+        });
+        m_nodes[n].children = m_nodes.size();
+        m_nodes.push_back({ begin, middle, 0 });
+        m_nodes.push_back({ middle, end, 0 });
+    }
+
+    m_seeds.resize(order.size());
+    for (std::size_t p = 0 ; p < order.size() ; ++p)
+        m_seeds[p] = indexed[order[p]];
+
+    // The kernels add the squared differences in single precision, as the bounds do
+    m_relativeError = (2 * pointSize + 16) * FLT_EPSILON;
+}
+
+void SeedTree::describe(const float* values, const int* offsets, unsigned int size, const NonCausalTerm* term,
+                        Query& query) const
+{
+    for (unsigned int l = 0 ; l < size ; ++l)
+    {
+        const auto entry = std::lower_bound(m_entryOffsets.begin(), m_entryOffsets.end(),
+                                            std::make_pair(offsets[l], 0u));
+        query.entries[entry->second] = values[l];
+    }
+
+    query.termCount = 0;
+    query.termMinimum = 0;
+    query.allowance = 0;
+    if (term && term->count > 0)
+    {
+        query.termCount = term->count;
+        query.allowance = describeTerm(*term, m_nbChannels, m_maxValue, query.means, query.termMinimum);
+    }
+}
+
+void SeedTree::splitBoundary(const CImg<bool>& inMask, const std::vector<int>& offsets, const RunSet& seeds,
+                              RunSet& boundary, std::vector<unsigned int>& others)
+{
+    boundary.clear();
+    others.clear();
+    for (const RunSet::Run& run : seeds.runs())
+    {
+        // Boundary seeds are gathered as runs, so that they are still searched run by run
+        unsigned int boundaryFirst = run.first;
+        unsigned int boundaryCount = 0;
+        for (unsigned int seed = run.first ; seed < run.first + run.count ; ++seed)
+        {
+            const bool reads = std::any_of(offsets.begin(), offsets.end(), [&](int offset)
+            {
+                return inMask[seed + offset];
+            });
+
+            if (reads)
+            {
+                if (boundaryCount == 0)
+                    boundaryFirst = seed;
+                ++boundaryCount;
+                continue;
+            }
+
+            boundary.add(boundaryFirst, boundaryCount);
+            boundaryCount = 0;
+            others.push_back(seed);
+        }
+
+        boundary.add(boundaryFirst, boundaryCount);
+    }
+}
+
+double SeedTree::describeTerm(const NonCausalTerm& term, unsigned int nbChannels, double maxValue, float* means,
+                               double& minimum)
+{
+    minimum = term.squaredSum;
+    double boundError = 0;
+    for (unsigned int ch = 0 ; ch < nbChannels ; ++ch)
+    {
+        const double mean = term.sum[ch] / term.count;
+        means[ch] = mean;
+        minimum -= term.sum[ch] * mean;
+        boundError += term.count * (maxValue + std::abs(mean)) * (maxValue + std::abs(mean));
+    }
+    minimum = std::max(0.0, minimum);
+
+    // The expanded form computed by the kernels is exact up to a few roundings of its products
+    double magnitude = term.squaredSum;
+    for (unsigned int ch = 0 ; ch < nbChannels ; ++ch)
+        magnitude += (term.count * maxValue + 2 * std::abs(term.sum[ch])) * maxValue;
+
+    return 2 * (nbChannels + 6) * FLT_EPSILON * magnitude + 8 * FLT_EPSILON * boundError;
+}
+
+double SeedTree::bound(const Query& query, unsigned int node) const
+{
+    const float* low = m_boxes.data() + std::size_t(node) * m_boxStride;
+    const float* high = low + m_boxStride / 2;
+
+    // The gap of an entry to the box is 0 when the entry lies in it
+    float distance = 0;
+    for (unsigned int d = 0 ; d < m_entrySize ; ++d)
+    {
+        const float gap = std::max(std::max(low[d] - query.entries[d], query.entries[d] - high[d]), 0.0f);
+        distance += gap * gap;
+    }
+
+    if (query.termCount > 0)
+    {
+        float centerDistance = 0;
+        for (unsigned int ch = 0 ; ch < m_nbChannels ; ++ch)
+        {
+            const float mean = query.means[ch];
+            const float gap = std::max(std::max(low[m_entrySize + ch] - mean, mean - high[m_entrySize + ch]), 0.0f);
+            centerDistance += gap * gap;
+        }
+        distance += query.termCount * centerDistance;
+    }
+
+    return ((1 - m_relativeError) * (distance + query.termMinimum) - query.allowance) * (1 + m_approximation);
+}
@@ -0,0 +1,225 @@
+#ifndef SEEDTREE_H
+#define SEEDTREE_H
+
+#include <utility>
+#include <vector>
+
+#include "CImg.h"
+
+#include "patchdistance.h"
+#include "runset.h"
+
+using namespace cimg_library;
+
+/**
+ * @brief The SeedTree class K-d tree over the neighborhood vectors of the seeds, each node holding the bounding box of
+ * the neighborhoods and centers of its seeds, so that a search skips the nodes whose box lies farther than the best
+ * distance found.
+ *
+ * The squared distance of a neighborhood to its clamp in a box bounds its distance to every seed of the box from
+ * below, and the non-causal term is bounded by the closest center of the box. Exact searches keep a rounding
+ * allowance, so that they find the seed an exhaustive kernel search finds; approximate searches also skip the nodes
+ * whose bound times 1 + epsilon exceeds the best distance, and find a seed at most 1 + epsilon times farther.
+ *
+ * Only the seeds whose neighborhood lies out the mask are in the tree, as their entries never change. The others are
+ * updated lazily: they are left out of the tree and searched exhaustively, so that their current neighborhoods are
+ * always read.
+ */
+class SeedTree
+{
+public:
+    using NonCausalTerm = PatchDistanceBase::NonCausalTerm;
+
+    static const unsigned int LeafSize = 32;    ///< Largest number of seeds of a leaf.
+    static const unsigned int MaxEntries = PatchDistanceBase::MaxChannels
+            * (2 * PatchDistanceBase::MaxRadius + 1) * (2 * PatchDistanceBase::MaxRadius + 1);  ///< Largest number of neighborhood entries.
+
+    /**
+     * @brief The Query struct Description of the neighborhood of a mask pixel.
+     */
+    struct Query
+    {
+        float entries[MaxEntries];      ///< Neighborhood entries, channel after channel.
+        float termCount;                ///< Number of reference pixels of the non-causal term, 0 if there is none.
+        float means[PatchDistanceBase::MaxChannels];   ///< Mean reference value of each channel of the term.
+        double termMinimum;             ///< Lowest value of the term, whatever the center.
+        double allowance;               ///< Rounding allowance of the bounds.
+    };
+
+private:
+    /**
+     * @brief The Delta struct Position of a neighborhood pixel relative to the center.
+     */
+    struct Delta
+    {
+        int dx, dy, dz;
+    };
+
+    /**
+     * @brief The Node struct Seeds of a subtree.
+     */
+    struct Node
+    {
+        std::size_t begin;          ///< Position of the first seed.
+        std::size_t end;            ///< Position following the last seed.
+        unsigned int children;      ///< Index of the first child, the second one follows it; 0 on leaves.
+    };
+
+    static const unsigned int MaxDepth = 64;    ///< Largest depth of the tree, the splits being at the medians.
+
+    std::vector<Delta> m_deltas;            ///< Neighborhood pixels, center excluded.
+    std::vector< std::pair<int, unsigned int> > m_entryOffsets;   ///< Linear offset of every entry and its position, by offset.
+    unsigned int m_nbChannels;              ///< Number of channels of the images.
+    unsigned int m_entrySize;               ///< Number of entries of a neighborhood, pixels times channels.
+    unsigned int m_boxStride;               ///< Number of floats of a box: lowest then highest entries and centers.
+    std::vector<Node> m_nodes;              ///< Nodes, the root first.
+    std::vector<float> m_boxes;             ///< Bounding box of every node.
+    std::vector<unsigned int> m_seeds;      ///< Linear index of every seed, increasing in a leaf.
+    RunSet m_boundary;                      ///< Seeds whose neighborhood reads a mask pixel.
+    double m_maxValue;                      ///< Largest absolute value of the seed centers.
+    double m_relativeError;                 ///< Rounding error of the kernels and of the bounds relative to a distance.
+    double m_approximation;                 ///< Tolerated relative excess of the distance found.
+
+public:
+    /**
+     * @brief Constructor
+     * @param radius Radius of the neighborhoods.
+     * @param dimensions Number of dimensions of the neighborhoods, 2 or 3.
+     */
+    explicit SeedTree(unsigned int radius = 1, unsigned int dimensions = 2);
+
+    /**
+     * @brief Build the tree of the seeds whose neighborhood lies out the mask, and set the others apart.
+     * @param image Image the neighborhoods are read from.
+     * @param inMask Flag image (or volume) of the mask pixels.
+     * @param seeds Linear indices of the seeds, lying at least the radius away from the border.
+     */
+    void assign(const CImg<>& image, const CImg<bool>& inMask, const RunSet& seeds);
+
+    /**
+     * @brief Get the approximation of the searches.
+     * @return Epsilon, 0 for exact searches.
+     */
+    double approximation() const
+    {
+        return m_approximation;
+    }
+
+    /**
+     * @brief Set the approximation of the searches, 0 by default.
+     * @param epsilon Tolerated relative excess of the distance found over the lowest one.
+     */
+    void setApproximation(double epsilon)
+    {
+        m_approximation = epsilon;
+    }
+
+    /**
+     * @brief Get the number of seeds in the tree.
+     * @return Number of seeds.
+     */
+    std::size_t size() const
+    {
+        return m_seeds.size();
+    }
+
+    /**
+     * @brief Get the seeds that are not in the tree.
+     * @return Runs of the seeds whose neighborhood reads a mask pixel.
+     */
+    const RunSet& boundary() const
+    {
+        return m_boundary;
+    }
+
+    /**
+     * @brief Describe the neighborhood of a pixel gathered by the kernels, whatever the order of its entries.
+     * @param values Values of the neighborhood entries.
+     * @param offsets Linear offsets of the entries relative to the center, channel planes included.
+     * @param size Number of entries.
+     * @param term Non-causal term added by the kernels, nullptr if there is none.
+     * @param query Output description.
+     */
+    void describe(const float* values, const int* offsets, unsigned int size, const NonCausalTerm* term,
+                  Query& query) const;
+
+    /**
+     * @brief Visit the leaves whose bound does not exceed a distance, the closest child of a node first.
+     * @param query Description of the neighborhood.
+     * @param distance Distance computed by the kernels, lowered by the visitor as closer seeds are found.
+     * @param visit Called with the linear indices of the seeds of a leaf, in increasing order, and their number.
+     */
+    template<class Visitor>
+    void search(const Query& query, const float& distance, Visitor visit) const
+    {
+        if (m_nodes.empty())
+            return;
+
+        std::pair<double, unsigned int> stack[MaxDepth + 1];
+        unsigned int depth = 0;
+        stack[depth++] = { bound(query, 0), 0 };
+        while (depth > 0)
+        {
+            // The bound is checked again, the distance having been lowered since the node was pushed
+            const std::pair<double, unsigned int> top = stack[--depth];
+            if (top.first > distance)
+                continue;
+
+            const Node& node = m_nodes[top.second];
+            if (node.children == 0)
+            {
+                visit(m_seeds.data() + node.begin, (unsigned int)(node.end - node.begin));
+                continue;
+            }
+
+            const double first = bound(query, node.children);
+            const double second = bound(query, node.children + 1);
+            if (first <= second)
+            {
+                stack[depth++] = { second, node.children + 1 };
+                stack[depth++] = { first, node.children };
+            }
+            else
+            {
+                stack[depth++] = { first, node.children };
+                stack[depth++] = { second, node.children + 1 };
+            }
+        }
+    }
+
+private:
+    /**
+     * @brief Get the lower bound of the distance computed by the kernels between a neighborhood and the seeds of a
+     * node, scaled by the approximation.
+     * @param query Description of the neighborhood.
+     * @param node Node.
+     * @return Lower bound of the distance.
+     */
+    double bound(const Query& query, unsigned int node) const;
+
+    /**
+     * @brief Set apart the seeds whose neighborhood reads a mask pixel.
+     * @param inMask Flag image (or volume) of the mask pixels.
+     * @param offsets Linear offsets of the neighborhood pixels relative to the center.
+     * @param seeds Linear indices of the seeds.
+     * @param boundary Output runs of the seeds whose neighborhood reads a mask pixel.
+     * @param others Output linear indices of the other seeds, in increasing order.
+     */
+    static void splitBoundary(const CImg<bool>& inMask, const std::vector<int>& offsets, const RunSet& seeds,
+                              RunSet& boundary, std::vector<unsigned int>& others);
+
+    /**
+     * @brief Bound the non-causal term added by the kernels from below, whatever the center of the seed. The term is
+     * count times the squared gap of the center to the reference mean, plus the reference variance.
+     * @param term Non-causal term, with at least one reference pixel.
+     * @param nbChannels Number of channels.
+     * @param maxValue Largest absolute value of the seed centers.
+     * @param means Output mean reference value of each channel.
+     * @param minimum Output lowest value of the term.
+     * @return Rounding allowance of the term computed by the kernels and of its bounds.
+     */
+    static double describeTerm(const NonCausalTerm& term, unsigned int nbChannels, double maxValue, float* means,
+                               double& minimum);
+};
+
+#endif // SEEDTREE_H
@@ -0,0 +1,39 @@
+#include "slidingmedian.h"
+
+#include <iterator>
+
+void SlidingMedian::balance()
+{
+    if (m_lower.size() > m_upper.size() + 1)
+    {
+        const auto last = std::prev(m_lower.end());
+        m_upper.insert(*last);
+        m_lower.erase(last);
+    }
+    else if (m_lower.size() < m_upper.size())
+    {
+        const auto first = m_upper.begin();
+        m_lower.insert(*first);
+        m_upper.erase(first);
+    }
+}
+
+void SlidingMedian::insert(double value)
+{
+    if (m_lower.empty() || value <= median())
+        m_lower.insert(value);
+    else
+        m_upper.insert(value);
+
+    balance();
+}
+
+void SlidingMedian::erase(double value)
+{
+    if (!m_lower.empty() && value <= median())
+        m_lower.erase(m_lower.find(value));
+    else
+        m_upper.erase(m_upper.find(value));
+
+    balance();
+}
@@ -0,0 +1,65 @@
+#ifndef SLIDINGMEDIAN_H
+#define SLIDINGMEDIAN_H
+
+#include <cstddef>
+#include <set>
+
+/**
+ * @brief The SlidingMedian class Maintains the lower median of a window of values in O(log w) per update.
+ *
+ * Values are split into two ordered halves: the lower one holds the ceil(n/2) smallest values, so that its largest
+ * value is the median.
+ */
+class SlidingMedian
+{
+private:
+    std::multiset<double> m_lower;  ///< Smallest half of the values, the median included.
+    std::multiset<double> m_upper;  ///< Largest half of the values.
+
+    /**
+     * @brief Move values between the halves until the lower one holds ceil(n/2) values.
+     */
+    void balance();
+
+public:
+    /**
+     * @brief Add a value.
+     * @param value Value.
+     */
+    void insert(double value);
+
+    /**
+     * @brief Remove one occurrence of a value previously added.
+     * @param value Value.
+     */
+    void erase(double value);
+
+    /**
+     * @brief Get the lower median, the ceil(n/2)-th smallest value.
+     * @return Median. The window must not be empty.
+     */
+    double median() const
+    {
+        return *m_lower.rbegin();
+    }
+
+    /**
+     * @brief Get the number of values.
+     * @return Number of values.
+     */
+    std::size_t size() const
+    {
+        return m_lower.size() + m_upper.size();
+    }
+
+    /**
+     * @brief Remove every value.
+     */
+    void clear()
+    {
+        m_lower.clear();
+        m_upper.clear();
+    }
+};
+
+#endif // SLIDINGMEDIAN_H
@@ -0,0 +1,680 @@
+#ifndef SOLVERPOLICIES_H
+#define SOLVERPOLICIES_H
+
+#include "CImg.h"
+
+#include "patchdistance.h"
+#include "patchmatrix.h"
+#include "runset.h"
+#include "seedtree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+using namespace cimg_library;
+
+/**
+ * @brief The BlockQuery struct Mask pixel searched by a block search, with its result.
+ */
+template<class Kernel, class Energy>
+struct BlockQuery
+{
+    int x, y, z;                    ///< Coordinates of the mask pixel.
+    typename Kernel::Patch patch;   ///< Neighborhood of the mask pixel.
+    typename Energy::Term term;     ///< Energy term of the mask pixel.
+    float bound;                    ///< Candidates farther than this distance are abandoned.
+    unsigned int bestIndex;         ///< Linear index of the first closest candidate.
+    double distance;                ///< Energy of the closest candidate.
+};
+
+/**
+ * @brief The CausalEnergy struct Energy policy comparing the neighborhoods only.
+ */
+struct CausalEnergy
+{
+    /**
+     * @brief The Term struct Empty term, nothing is added to the neighborhood distance.
+     */
+    struct Term
+    {
+    };
+
+    /**
+     * @brief Build the term of a mask pixel.
+     * @return Empty term.
+     */
+    template<class Kernel>
+    static Term term(const Kernel&, const CImg<>&, const CImg<bool>&, int, int, int)
+    {
+        return Term();
+    }
+
+    /**
+     * @brief Get the non-causal part of a term.
+     * @return nullptr, there is none.
+     */
+    static const PatchDistanceBase::NonCausalTerm* nonCausal(const Term&)
+    {
+        return nullptr;
+    }
+
+    /**
+     * @brief Compute the distance of a candidate, equal to the one a search computes.
+     */
+    template<class Kernel>
+    static float distance(const Kernel& kernel, const float* data, const typename Kernel::Patch& patch, const Term&,
+                          unsigned int candidate)
+    {
+        return kernel.distance(data, patch, candidate);
+    }
+
+    /**
+     * @brief Find the closest of a set of candidates.
+     */
+    template<class Kernel>
+    static float findBest(const Kernel& kernel, const float* data, const typename Kernel::Patch& patch, const Term&,
+                          const unsigned int* candidates, unsigned int count, float bound, unsigned int& best,
+                          typename Kernel::Statistics& statistics)
+    {
+        return kernel.findBest(data, patch, candidates, count, bound, best, statistics);
+    }
+
+    /**
+     * @brief Find the closest of a run of consecutive candidates.
+     */
+    template<class Kernel>
+    static float findBestRange(const Kernel& kernel, const float* data, const typename Kernel::Patch& patch, const Term&,
+                               unsigned int first, unsigned int count, float bound, unsigned int& best,
+                               typename Kernel::Statistics& statistics)
+    {
+        return kernel.findBestRange(data, patch, first, count, bound, best, statistics);
+    }
+};
+
+/**
+ * @brief The NonCausalEnergy struct Energy policy adding the probabilistic non-causal term to the neighborhood
+ * distance: every neighbor in the mask (8 on images, 26 on volumes) is compared to its mirror around the pixel.
+ */
+struct NonCausalEnergy
+{
+    using Term = PatchDistance::NonCausalTerm;
+
+    /**
+     * @brief Build the term of a mask pixel.
+     * @param kernel Distance kernel.
+     * @param source Image the pixels are read from.
+     * @param inMask Flag image of the mask pixels.
+     * @param x x coordinate of the pixel.
+     * @param y y coordinate of the pixel.
+     * @param z z coordinate of the pixel.
+     * @return Non causal term, to be evaluated on the value of each candidate.
+     */
+    template<class Kernel>
+    static Term term(const Kernel& kernel, const CImg<>& source, const CImg<bool>& inMask, int x, int y, int z)
+    {
+        // Neighbors in the mask are compared to their mirror around the pixel, the others have a null ponderation
+        float references[Kernel::PatchSize * Kernel::MaxChannels];
+        unsigned int nbReferences = 0;
+        unsigned int n = 0;
+        const int rz = inMask.depth() > 1 ? 1 : 0;
+        for (int dz = -rz ; dz <= rz ; ++dz)
+        {
+            for (int dy = -1 ; dy <= 1 ; ++dy)
+            {
+                for (int dx = -1 ; dx <= 1 ; ++dx)
+                {
+                    if ((dx || dy || dz) && inMask.atXYZ(x + dx, y + dy, z + dz, 0, false))
+                    {
+                        cimg_forC(source, c)
+                            references[n++] = source._atXYZ(x - dx, y - dy, z - dz, c);
+                        ++nbReferences;
+                    }
+                }
+            }
+        }
+
+        return kernel.nonCausalTerm(references, nbReferences);
+    }
+
+    /**
+     * @brief Get the non-causal part of a term.
+     * @param term Term.
+     * @return The term itself.
+     */
+    static const PatchDistanceBase::NonCausalTerm* nonCausal(const Term& term)
+    {
+        return &term;
+    }
+
+    /**
+     * @brief Compute the distance of a candidate, equal to the one a search computes.
+     */
+    template<class Kernel>
+    static float distance(const Kernel& kernel, const float* data, const typename Kernel::Patch& patch, const Term& term,
+                          unsigned int candidate)
+    {
+        return kernel.distance(data, patch, term, candidate);
+    }
+
+    /**
+     * @brief Find the closest of a set of candidates.
+     */
+    template<class Kernel>
+    static float findBest(const Kernel& kernel, const float* data, const typename Kernel::Patch& patch, const Term& term,
+                          const unsigned int* candidates, unsigned int count, float bound, unsigned int& best,
+                          typename Kernel::Statistics& statistics)
+    {
+        return kernel.findBest(data, patch, term, candidates, count, bound, best, statistics);
+    }
+
+    /**
+     * @brief Find the closest of a run of consecutive candidates.
+     */
+    template<class Kernel>
+    static float findBestRange(const Kernel& kernel, const float* data, const typename Kernel::Patch& patch, const Term& term,
+                               unsigned int first, unsigned int count, float bound, unsigned int& best,
+                               typename Kernel::Statistics& statistics)
+    {
+        return kernel.findBestRange(data, patch, term, first, count, bound, best, statistics);
+    }
+};
+
+/**
+ * @brief The GlobalCandidates class Candidate policy searching every pixel out the mask having a full neighborhood.
+ */
+class GlobalCandidates
+{
+private:
+    /**
+     * @brief The Closest struct Closest candidate of a search visiting the candidates out of index order.
+     */
+    struct Closest
+    {
+        float distance;         ///< Lowest distance, candidates farther than it are abandoned.
+        unsigned int index;     ///< Linear index of the first closest candidate.
+
+        /**
+         * @brief Keep a candidate if it is closer, or as close with a lower index, as in the exhaustive search.
+         * @param dist Distance of the candidate.
+         * @param candidate Linear index of the candidate.
+         */
+        void keep(float dist, unsigned int candidate)
+        {
+            if (dist < distance || (dist == distance && candidate < index))
+            {
+                distance = dist;
+                index = candidate;
+            }
+        }
+    };
+
+    RunSet m_seeds;     ///< Runs of pixels out the mask having a full neighborhood, along the rows.
+    int m_width;        ///< Width of the image.
+    int m_height;       ///< Height of the image.
+    int m_depth;        ///< Depth of the image.
+    int m_margin;       ///< Distance of the candidates to the image border.
+    int m_marginZ;      ///< Distance of the candidates to the first and last slices, 0 on images.
+    PatchMatrix m_matrix;   ///< Neighborhoods of the candidates packed by prepareBlocks.
+    SeedTree m_tree;        ///< K-d tree of the candidates, used by search once buildTree is called.
+    bool m_treeBuilt;       ///< Search through the tree.
+
+public:
+    /**
+     * @brief Constructor
+     */
+    GlobalCandidates()
+        : m_seeds()
+        , m_width(0)
+        , m_height(0)
+        , m_depth(0)
+        , m_margin(1)
+        , m_marginZ(0)
+        , m_matrix()
+        , m_tree()
+        , m_treeBuilt(false)
+    {
+
+    }
+
+    /**
+     * @brief Compute the candidates of an image.
+     * @param image Image.
+     * @param inMask Flag image of the mask pixels.
+     * @param radius Patch radius, candidates lie at least this far from the border.
+     */
+    void initialize(const CImg<>& image, const CImg<bool>& inMask, unsigned int radius)
+    {
+        m_width = image.width();
+        m_height = image.height();
+        m_depth = image.depth();
+        m_margin = radius;
+        m_marginZ = m_depth > 1 ? m_margin : 0;
+        m_matrix = PatchMatrix(radius, m_depth > 1 ? 3 : 2);
+        m_tree = SeedTree(radius, m_depth > 1 ? 3 : 2);
+        m_treeBuilt = false;
+
+        // Seeds need a full neighborhood
+        m_seeds.clear();
+        for (int z = m_marginZ ; z < m_depth - m_marginZ ; ++z)
+        {
+            for (int y = m_margin ; y < m_height - m_margin ; ++y)
+                m_seeds.addUnmasked(inMask, m_margin, m_width - m_margin, y, z);
+        }
+    }
+
+    /**
+     * @brief Check if a pixel has a full neighborhood.
+     * @param x x coordinate of the pixel.
+     * @param y y coordinate of the pixel.
+     * @param z z coordinate of the pixel.
+     * @return True if the neighborhood lies in the image.
+     */
+    bool inside(int x, int y, int z = 0) const
+    {
+        return x >= m_margin && y >= m_margin && x < m_width - m_margin && y < m_height - m_margin
+                && z >= m_marginZ && z < m_depth - m_marginZ;
+    }
+
+    /**
+     * @brief Check if a pixel is a candidate of a mask pixel.
+     * @param inMask Flag image of the mask pixels.
+     * @param candidate Linear index of the pixel.
+     * @return True if the pixel would be searched.
+     */
+    bool contains(const CImg<bool>& inMask, int, int, int, unsigned int candidate) const
+    {
+        const int x = candidate % m_width;
+        const int y = (candidate / m_width) % m_height;
+        const int z = candidate / (m_width * m_height);
+
+        return inside(x, y, z) && !inMask[candidate];
+    }
+
+    /**
+     * @brief Find the candidate of a mask pixel with the lowest energy, run by run or through the tree.
+     * @param kernel Distance kernel.
+     * @param source Image the neighborhoods of the candidates are read from.
+     * @param patch Neighborhood of the mask pixel.
+     * @param term Energy term of the mask pixel.
+     * @param x x coordinate of the mask pixel.
+     * @param y y coordinate of the mask pixel.
+     * @param z z coordinate of the mask pixel.
+     * @param bound Candidates farther than this distance are abandoned.
+     * @param bestIndex Linear index of the first closest candidate.
+     * @param statistics Counters incremented by the search.
+     * @return Energy of the closest candidate.
+     */
+    template<class Energy, class Kernel>
+    double search(const Kernel& kernel, const CImg<>& source, const typename Kernel::Patch& patch,
+                  const typename Energy::Term& term, int x, int y, int z, float bound, unsigned int& bestIndex,
+                  typename Kernel::Statistics& statistics) const
+    {
+        if (m_treeBuilt)
+        {
+            // Approximate searches may skip the candidate at the bound, they start without one. The candidates reading
+            // the mask are searched run by run, with their current neighborhoods
+            const bool approximate = m_tree.approximation() > 0;
+            Closest closest = { approximate ? std::numeric_limits<float>::max() : bound, std::numeric_limits<unsigned int>::max() };
+            for (const RunSet::Run& run : m_tree.boundary().runs())
+            {
+                unsigned int best = 0;
+                const float dist = Energy::findBestRange(kernel, source.data(), patch, term, run.first, run.count, closest.distance, best, statistics);
+                closest.keep(dist, run.first + best);
+            }
+
+            const std::size_t nbSkipped = searchTree<Energy>(kernel, source, patch, term, closest, statistics);
+            statistics.nbCandidates += nbSkipped;
+            statistics.nbPruned += nbSkipped;
+
+            bestIndex = closest.index;
+            if (closest.distance == std::numeric_limits<float>::max() || closest.index == std::numeric_limits<unsigned int>::max())
+            {
+                bestIndex = m_seeds.runs().empty() ? 0 : m_seeds.runs().front().first;
+                return std::numeric_limits<float>::max();
+            }
+
+            return closest.distance;
+        }
+
+        // The first minimum over the runs is the first minimum over the whole set
+        float lowestDist = std::numeric_limits<float>::max();
+        bestIndex = m_seeds.runs().empty() ? 0 : m_seeds.runs().front().first;
+        for (const RunSet::Run& run : m_seeds.runs())
+        {
+            unsigned int best = 0;
+            const float dist = Energy::findBestRange(kernel, source.data(), patch, term, run.first, run.count, bound, best, statistics);
+            if (dist < lowestDist)
+            {
+                lowestDist = dist;
+                bestIndex = run.first + best;
+                bound = dist;
+            }
+        }
+
+        return lowestDist;
+    }
+
+    /**
+     * @brief Build the k-d tree of the candidates, so that the following searches skip most of them.
+     * @param image Image the neighborhoods are read from.
+     * @param inMask Flag image of the mask pixels.
+     * @param approximation Tolerated relative excess of the distance found, 0 for the same results as without tree.
+     */
+    void buildTree(const CImg<>& image, const CImg<bool>& inMask, double approximation)
+    {
+        m_tree.setApproximation(approximation);
+        m_tree.assign(image, inMask, m_seeds);
+        m_treeBuilt = true;
+    }
+
+    /**
+     * @brief Pack the neighborhoods of the candidates, before block searches.
+     * @param source Image the neighborhoods are read from, unchanged until the block searches end.
+     */
+    void prepareBlocks(const CImg<>& source)
+    {
+        m_matrix.assign(source, m_seeds);
+    }
+
+    /**
+     * @brief Find the candidate with the lowest energy of each mask pixel of a block, with the same result as
+     * search. The candidates are shortlisted by a matrix product, then the shortlisted ones are scored by the kernel.
+     * @param kernel Distance kernel.
+     * @param source Image given to prepareBlocks.
+     * @param queries Mask pixels, receiving their closest candidate.
+     * @param count Number of mask pixels.
+     * @param statistics Counters incremented by the search.
+     */
+    template<class Energy, class Kernel>
+    void searchBlock(const Kernel& kernel, const CImg<>& source, BlockQuery<Kernel, Energy>* queries, unsigned int count,
+                     typename Kernel::Statistics& statistics) const
+    {
+        const unsigned int rowSize = m_matrix.rowSize();
+        std::vector<float> rows(std::size_t(count) * rowSize);
+        std::vector<PatchDistanceBase::NonCausalTerm> terms;
+        for (unsigned int q = 0 ; q < count ; ++q)
+        {
+            m_matrix.gather(source, queries[q].x, queries[q].y, queries[q].z, rows.data() + std::size_t(q) * rowSize);
+            if (const PatchDistanceBase::NonCausalTerm* term = Energy::nonCausal(queries[q].term))
+                terms.push_back(*term);
+        }
+
+        std::vector< std::vector<unsigned int> > shortlists(count);
+        m_matrix.shortlist(rows.data(), terms.empty() ? nullptr : terms.data(), count, shortlists.data());
+
+        // Shortlisted candidates are in seed order, so that the first closest one is kept
+        for (unsigned int q = 0 ; q < count ; ++q)
+        {
+            BlockQuery<Kernel, Energy>& query = queries[q];
+            float lowestDist = std::numeric_limits<float>::max();
+            query.bestIndex = m_seeds.runs().empty() ? 0 : m_seeds.runs().front().first;
+            for (unsigned int position : shortlists[q])
+            {
+                const unsigned int candidate = m_matrix.seed(position);
+                const float dist = Energy::distance(kernel, source.data(), query.patch, query.term, candidate);
+                if (dist < lowestDist)
+                {
+                    lowestDist = dist;
+                    query.bestIndex = candidate;
+                }
+            }
+            query.distance = lowestDist;
+            statistics.nbPruned += m_matrix.size() - shortlists[q].size();
+        }
+
+        statistics.nbCandidates += std::size_t(count) * m_matrix.size();
+    }
+
+    /**
+     * @brief Get the candidates.
+     * @return Runs of candidates.
+     */
+    const RunSet& seeds() const
+    {
+        return m_seeds;
+    }
+
+private:
+    /**
+     * @brief Search the candidates of a mask pixel in the tree, scoring the leaves whose bound does not exceed the
+     * lowest distance.
+     * @param kernel Distance kernel.
+     * @param source Image the neighborhoods of the candidates are read from.
+     * @param patch Neighborhood of the mask pixel.
+     * @param term Energy term of the mask pixel.
+     * @param closest Closest candidate, updated by the search.
+     * @param statistics Counters incremented by the search.
+     * @return Number of candidates of the tree skipped.
+     */
+    template<class Energy, class Kernel>
+    std::size_t searchTree(const Kernel& kernel, const CImg<>& source, const typename Kernel::Patch& patch,
+                           const typename Energy::Term& term, Closest& closest,
+                           typename Kernel::Statistics& statistics) const
+    {
+        SeedTree::Query query;
+        m_tree.describe(patch.values, patch.offsets, patch.size, Energy::nonCausal(term), query);
+
+        std::size_t nbScored = 0;
+        m_tree.search(query, closest.distance, [&](const unsigned int* seeds, unsigned int count)
+        {
+            unsigned int best = 0;
+            const float dist = Energy::findBest(kernel, source.data(), patch, term, seeds, count, closest.distance, best, statistics);
+            closest.keep(dist, seeds[best]);
+            nbScored += count;
+        });
+
+        return m_tree.size() - nbScored;
+    }
+};
+
+/**
+ * @brief The WindowCandidates class Candidate policy searching the pixels of a square window (a box on volumes)
+ * around the mask pixel, the pixel itself excluded (codebook optimization). Mask pixels of the window are searched
+ * with their current values.
+ */
+class WindowCandidates
+{
+public:
+    /**
+     * @brief The Window struct Bounds (inclusive) of a box of pixels.
+     */
+    struct Window
+    {
+        int beginX, endX;
+        int beginY, endY;
+        int beginZ, endZ;
+    };
+
+private:
+    unsigned int m_neighborhoodSize;    ///< Size of the neighborhood considered.
+    int m_width;        ///< Width of the image.
+    int m_height;       ///< Height of the image.
+    int m_depth;        ///< Depth of the image.
+    int m_margin;       ///< Distance of the candidates to the image border.
+    int m_marginZ;      ///< Distance of the candidates to the first and last slices, 0 on images.
+
+public:
+    /**
+     * @brief Constructor
+     * @param neighborhoodSize Size of the neighborhood to consider around mask pixels.
+     */
+    explicit WindowCandidates(unsigned int neighborhoodSize)
+        : m_neighborhoodSize(neighborhoodSize)
+        , m_width(0)
+        , m_height(0)
+        , m_depth(0)
+        , m_margin(1)
+        , m_marginZ(0)
+    {
+
+    }
+
+    /**
+     * @brief Store the dimensions of an image, the windows being clipped to them.
+     * @param image Image.
+     * @param radius Patch radius, candidates lie at least this far from the border.
+     */
+    void initialize(const CImg<>& image, const CImg<bool>&, unsigned int radius)
+    {
+        m_width = image.width();
+        m_height = image.height();
+        m_depth = image.depth();
+        m_margin = radius;
+        m_marginZ = m_depth > 1 ? m_margin : 0;
+    }
+
+    /**
+     * @brief Compute the window of neighbors of a mask pixel. Neighbors are the pixels of the window other than the
+     * mask pixel itself.
+     * @param x x coordinate of the mask pixel.
+     * @param y y coordinate of the mask pixel.
+     * @param z z coordinate of the mask pixel.
+     * @return Window clipped to the pixels having a full neighborhood.
+     */
+    Window window(int x, int y, int z) const
+    {
+        // Security margin of the patch radius (for safe neighborhood loops)
+        const int size = m_neighborhoodSize;
+
+        Window window;
+        window.beginX = std::max(m_margin, x - size);
+        window.endX = std::min(x + size, m_width - 1 - m_margin);
+        window.beginY = std::max(m_margin, y - size);
+        window.endY = std::min(y + size, m_height - 1 - m_margin);
+        window.beginZ = std::max(m_marginZ, z - size);
+        window.endZ = std::min(z + size, m_depth - 1 - m_marginZ);
+
+        return window;
+    }
+
+    /**
+     * @brief Check if a pixel is a candidate of a mask pixel.
+     * @param x x coordinate of the mask pixel.
+     * @param y y coordinate of the mask pixel.
+     * @param z z coordinate of the mask pixel.
+     * @param candidate Linear index of the pixel.
+     * @return True if the pixel would be searched.
+     */
+    bool contains(const CImg<bool>&, int x, int y, int z, unsigned int candidate) const
+    {
+        const Window w = window(x, y, z);
+        const int cx = candidate % m_width;
+        const int cy = (candidate / m_width) % m_height;
+        const int cz = candidate / (m_width * m_height);
+
+        return cx >= w.beginX && cx <= w.endX && cy >= w.beginY && cy <= w.endY && cz >= w.beginZ && cz <= w.endZ
+                && (cx != x || cy != y || cz != z);
+    }
+
+    /**
+     * @brief Find the candidate of a mask pixel with the lowest energy, row by row.
+     * @param kernel Distance kernel.
+     * @param source Image the neighborhoods of the candidates are read from.
+     * @param patch Neighborhood of the mask pixel.
+     * @param term Energy term of the mask pixel.
+     * @param x x coordinate of the mask pixel.
+     * @param y y coordinate of the mask pixel.
+     * @param z z coordinate of the mask pixel.
+     * @param bound Candidates farther than this distance are abandoned.
+     * @param bestIndex Linear index of the first closest candidate, 0 if the window has none.
+     * @param statistics Counters incremented by the search.
+     * @return Energy of the closest candidate, the maximum double value if the window has none.
+     */
+    template<class Energy, class Kernel>
+    double search(const Kernel& kernel, const CImg<>& source, const typename Kernel::Patch& patch,
+                  const typename Energy::Term& term, int x, int y, int z, float bound, unsigned int& bestIndex,
+                  typename Kernel::Statistics& statistics) const
+    {
+        const Window w = window(x, y, z);
+
+        double lowestDist = std::numeric_limits<double>::max();
+        bestIndex = 0;
+        const auto searchRange = [&](unsigned int first, unsigned int length)
+        {
+            if (length == 0)
+                return;
+
+            unsigned int best = 0;
+            const float dist = Energy::findBestRange(kernel, source.data(), patch, term, first, length, bound, best, statistics);
+            if (dist < lowestDist)
+            {
+                lowestDist = dist;
+                bestIndex = first + best;
+                bound = dist;
+            }
+        };
+
+        if (w.beginX > w.endX)
+            return lowestDist;
+
+        for (int k = w.beginZ ; k <= w.endZ ; ++k)
+        {
+            for (int j = w.beginY ; j <= w.endY ; ++j)
+            {
+                // The row of the pixel is split around it, so that the ranges stay in index order
+                const unsigned int begin = source.offset(w.beginX, j, k);
+                const unsigned int end = source.offset(w.endX, j, k) + 1;
+                if (j == y && k == z && x >= w.beginX && x <= w.endX)
+                {
+                    const unsigned int center = source.offset(x, j, k);
+                    searchRange(begin, center - begin);
+                    searchRange(center + 1, end - center - 1);
+                }
+                else
+                    searchRange(begin, end - begin);
+            }
+        }
+
+        return lowestDist;
+    }
+
+    /**
+     * @brief Build the tree of the candidates, nothing to do as the windows are searched exhaustively.
+     */
+    void buildTree(const CImg<>&, const CImg<bool>&, double)
+    {
+
+    }
+
+    /**
+     * @brief Prepare block searches, nothing to do as the windows differ.
+     */
+    void prepareBlocks(const CImg<>&)
+    {
+
+    }
+
+    /**
+     * @brief Find the candidate with the lowest energy of each mask pixel of a block, one window after the other.
+     * @param kernel Distance kernel.
+     * @param source Image the neighborhoods are read from.
+     * @param queries Mask pixels, receiving their closest candidate.
+     * @param count Number of mask pixels.
+     * @param statistics Counters incremented by the search.
+     */
+    template<class Energy, class Kernel>
+    void searchBlock(const Kernel& kernel, const CImg<>& source, BlockQuery<Kernel, Energy>* queries, unsigned int count,
+                     typename Kernel::Statistics& statistics) const
+    {
+        for (unsigned int q = 0 ; q < count ; ++q)
+        {
+            BlockQuery<Kernel, Energy>& query = queries[q];
+            query.distance = search<Energy>(kernel, source, query.patch, query.term, query.x, query.y, query.z,
+                                            query.bound, query.bestIndex, statistics);
+        }
+    }
+
+    /**
+     * @brief Get the used neighborhood size.
+     * @return Neighborhood size.
+     */
+    unsigned int neighborhoodSize() const
+    {
+        return m_neighborhoodSize;
+    }
+};
+
+#endif // SOLVERPOLICIES_H
@@ -0,0 +1,96 @@
+#include "telemetrysink.h"
+
+#include "CImg.h"
+
+using namespace cimg_library;
+
+TelemetrySink::TelemetrySink(const std::string& filename, Format format)
+    : m_file(filename, std::ios::trunc | std::ios::out)
+    , m_format(format)
+    , m_buffer()
+    , m_stop(false)
+    , m_nbRuns(0)
+    , m_start(std::chrono::steady_clock::now())
+{
+    if (!m_file)
+        throw CImgIOException("TelemetrySink: cannot create '%s'.", filename.c_str());
+
+    m_file.precision(10);
+    if (m_format == Format::CSV)
+        m_file << "run,iteration,energy,ratio,time,duration,candidates,changed\n";
+
+    m_buffer.reserve(BufferSize);
+    m_writer = std::thread(&TelemetrySink::write, this);
+}
+
+TelemetrySink::~TelemetrySink()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_flush.notify_one();
+
+    m_writer.join();
+}
+
+TelemetrySink::Format TelemetrySink::formatOf(const std::string& filename)
+{
+    const std::size_t dot = filename.rfind('.');
+    const std::string extension = dot == std::string::npos ? "" : filename.substr(dot);
+
+    return (extension == ".json" || extension == ".jsonl") ? Format::JSON_LINES : Format::CSV;
+}
+
+double TelemetrySink::now() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+void TelemetrySink::push(const Record& record)
+{
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_buffer.push_back(record);
+        full = m_buffer.size() >= BufferSize;
+    }
+
+    if (full)
+        m_flush.notify_one();
+}
+
+void TelemetrySink::write()
+{
+    std::vector<Record> records;
+    records.reserve(BufferSize);
+
+    bool stop = false;
+    while (!stop)
+    {
+        {
+            // Records are written when the buffer is full, at most every second otherwise
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_flush.wait_for(lock, std::chrono::seconds(1), [this]{ return m_stop || m_buffer.size() >= BufferSize; });
+            records.swap(m_buffer);
+            stop = m_stop;
+        }
+
+        for (const Record& r : records)
+        {
+            if (m_format == Format::CSV)
+            {
+                m_file << r.run << ',' << r.iteration << ',' << r.energy << ',' << r.ratio << ',' << r.time << ','
+                       << r.duration << ',' << r.nbCandidates << ',' << r.nbChanged << '\n';
+            }
+            else
+            {
+                m_file << "{\"run\":" << r.run << ",\"iteration\":" << r.iteration << ",\"energy\":" << r.energy
+                       << ",\"ratio\":" << r.ratio << ",\"time\":" << r.time << ",\"duration\":" << r.duration
+                       << ",\"candidates\":" << r.nbCandidates << ",\"changed\":" << r.nbChanged << "}\n";
+            }
+        }
+        records.clear();
+        m_file.flush();
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef TELEMETRYSINK_H
+#define TELEMETRYSINK_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief The TelemetrySink class Collects the records of the iterations of one or several algorithms into a file.
+ *
+ * Records are appended to a memory buffer, then formatted and written by a background thread, so that the solve
+ * loops never wait for the file. The buffer is written when it gets full, every second, and when the sink is
+ * destroyed.
+ */
+class TelemetrySink
+{
+public:
+    /**
+     * @brief The Format enum Enumerate the file formats.
+     */
+    enum class Format
+    {
+        CSV,            ///< Header line, then one comma separated line per record.
+        JSON_LINES,     ///< One JSON object per line.
+    };
+
+    /**
+     * @brief The Record struct Statistics of an iteration.
+     */
+    struct Record
+    {
+        unsigned int run;                   ///< Algorithm the iteration belongs to, as numbered by newRun.
+        unsigned int iteration;             ///< Iteration index within the run.
+        double energy;                      ///< Energy of the iteration.
+        double ratio;                       ///< Relative energy change from the previous iteration.
+        double time;                        ///< Wall time at the end of the iteration, in seconds since the sink creation.
+        double duration;                    ///< Wall time of the iteration, in seconds.
+        unsigned long long nbCandidates;    ///< Number of candidates considered.
+        unsigned long long nbChanged;       ///< Number of mask pixels whose value changed.
+    };
+
+    static const std::size_t BufferSize = 4096;     ///< Number of records buffered before a flush is requested.
+
+private:
+    std::ofstream m_file;       ///< Output file.
+    Format m_format;            ///< Output format.
+
+    std::mutex m_mutex;                 ///< Protects the buffer and the stop flag.
+    std::condition_variable m_flush;    ///< Signals the writer thread that records are waiting.
+    std::vector<Record> m_buffer;       ///< Records not written yet.
+    bool m_stop;                        ///< Flag asking the writer thread to exit.
+    std::atomic<unsigned int> m_nbRuns; ///< Number of runs created.
+    std::chrono::steady_clock::time_point m_start;  ///< Creation time.
+    std::thread m_writer;               ///< Thread formatting and writing the records.
+
+    /**
+     * @brief Writer thread loop.
+     */
+    void write();
+
+public:
+    /**
+     * @brief Constructor. Throws a CImgIOException if the file cannot be created.
+     * @param filename Output file name, created or overwritten.
+     * @param format Output format.
+     */
+    TelemetrySink(const std::string& filename, Format format);
+
+    /**
+     * @brief Destructor. Write the remaining records and wait for the writer thread.
+     */
+    ~TelemetrySink();
+
+    TelemetrySink(const TelemetrySink&) = delete;
+    TelemetrySink& operator=(const TelemetrySink&) = delete;
+
+    /**
+     * @brief Choose the format from a file name: JSON lines for .json and .jsonl files, CSV otherwise.
+     * @param filename File name.
+     * @return Format.
+     */
+    static Format formatOf(const std::string& filename);
+
+    /**
+     * @brief Number a new run, e.g. an algorithm starting to record its iterations.
+     * @return Run number.
+     */
+    unsigned int newRun()
+    {
+        return m_nbRuns++;
+    }
+
+    /**
+     * @brief Get the wall time elapsed since the sink creation.
+     * @return Time in seconds.
+     */
+    double now() const;
+
+    /**
+     * @brief Append a record. Can be called concurrently.
+     * @param record Record.
+     */
+    void push(const Record& record);
+};
+
+#endif // TELEMETRYSINK_H
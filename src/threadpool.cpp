@@ -0,0 +1,85 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int nbThreads)
+    : m_nbTasks(0)
+    , m_nextTask(0)
+    , m_nbBusy(0)
+    , m_batch(0)
+    , m_stop(false)
+{
+    if (nbThreads == 0)
+        nbThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned int t = 1 ; t < nbThreads ; ++t)
+        m_threads.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+void ThreadPool::run(std::size_t nbTasks, const std::function<void(std::size_t)>& task)
+{
+    if (m_threads.empty() || nbTasks <= 1)
+    {
+        for (std::size_t t = 0 ; t < nbTasks ; ++t)
+            task(t);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = task;
+        m_nbTasks = nbTasks;
+        m_nextTask = 0;
+        m_nbBusy = m_threads.size();
+        ++m_batch;
+    }
+    m_wakeUp.notify_all();
+
+    runTasks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_nbBusy == 0; });
+    m_task = nullptr;
+}
+
+void ThreadPool::work()
+{
+    unsigned long lastBatch = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [&] { return m_stop || m_batch != lastBatch; });
+            if (m_stop)
+                return;
+            lastBatch = m_batch;
+        }
+
+        runTasks();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_nbBusy;
+        }
+        m_done.notify_one();
+    }
+}
+
+void ThreadPool::runTasks()
+{
+    for (std::size_t t = m_nextTask++ ; t < m_nbTasks ; t = m_nextTask++)
+        m_task(t);
+}
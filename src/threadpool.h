@@ -0,0 +1,72 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief The ThreadPool class Runs batches of independent tasks on a fixed set of threads.
+ */
+class ThreadPool
+{
+private:
+    std::vector<std::thread> m_threads;     ///< Worker threads.
+
+    std::mutex m_mutex;                     ///< Protects the batch state.
+    std::condition_variable m_wakeUp;       ///< Signals workers that a batch is available.
+    std::condition_variable m_done;         ///< Signals the caller that every worker left the batch.
+
+    std::function<void(std::size_t)> m_task;    ///< Task of the current batch, called with the task index.
+    std::size_t m_nbTasks;                  ///< Number of tasks of the current batch.
+    std::atomic<std::size_t> m_nextTask;    ///< Next task index to execute.
+    unsigned int m_nbBusy;                  ///< Number of workers still working on the current batch.
+    unsigned long m_batch;                  ///< Batch counter, used to wake workers only once per batch.
+    bool m_stop;                            ///< Flag asking workers to exit.
+
+    /**
+     * @brief Worker thread loop.
+     */
+    void work();
+
+    /**
+     * @brief Execute tasks of the current batch until there is none left.
+     */
+    void runTasks();
+
+public:
+    /**
+     * @brief Constructor
+     * @param nbThreads Number of threads executing tasks, including the calling thread. 0 means one per core.
+     */
+    explicit ThreadPool(unsigned int nbThreads = 0);
+
+    /**
+     * @brief Destructor. Wait for the worker threads to exit.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Get the number of threads executing tasks, including the calling thread.
+     * @return Number of threads.
+     */
+    unsigned int size() const
+    {
+        return m_threads.size() + 1;
+    }
+
+    /**
+     * @brief Execute a batch of tasks and wait for their completion. The calling thread takes part in the execution.
+     * @param nbTasks Number of tasks.
+     * @param task Task to execute, called once for each index in [0, nbTasks).
+     */
+    void run(std::size_t nbTasks, const std::function<void(std::size_t)>& task);
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,143 @@
+#include "tiledpipeline.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+
+/**
+ * @brief Read a rectangle of pixels.
+ * @return Image of the pixels in [x0, x1] x [y0, y1].
+ */
+CImg<> readTile(std::ifstream& file, const TiledPipeline::Header& header, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1)
+{
+    CImg<> tile(x1 - x0 + 1, y1 - y0 + 1);
+    cimg_forY(tile, y)
+    {
+        file.seekg(header.dataOffset + ((long long)(y0 + y) * header.width + x0) * sizeof(float));
+        file.read(reinterpret_cast<char*>(tile.data(0, y)), tile.width() * sizeof(float));
+    }
+
+    if (!file)
+        throw CImgIOException("TiledPipeline: cannot read the tile (%u,%u)-(%u,%u).", x0, y0, x1, y1);
+
+    return tile;
+}
+
+/**
+ * @brief Write a rectangle of pixels at position (x0, y0).
+ */
+void writeTile(std::ofstream& file, const TiledPipeline::Header& header, unsigned int x0, unsigned int y0, const CImg<>& tile)
+{
+    cimg_forY(tile, y)
+    {
+        file.seekp(header.dataOffset + ((long long)(y0 + y) * header.width + x0) * sizeof(float));
+        file.write(reinterpret_cast<const char*>(tile.data(0, y)), tile.width() * sizeof(float));
+    }
+
+    if (!file)
+        throw CImgIOException("TiledPipeline: cannot write the tile at (%u,%u).", x0, y0);
+}
+
+}
+
+TiledPipeline::TiledPipeline(AlgorithmFactory factory,
+                             unsigned int tileSize,
+                             unsigned int halo,
+                             bool verbose)
+    : m_factory(factory)
+    , m_tileSize(std::max(1u, tileSize))
+    , m_halo(halo)
+    , m_verbose(verbose)
+{
+
+}
+
+TiledPipeline::Header TiledPipeline::readHeader(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+
+    // "<number of images> <pixel type> <endianness>" then "<width> <height> <depth> <spectrum>"
+    std::string list, size;
+    std::getline(file, list);
+    std::getline(file, size);
+
+    unsigned int nbImages = 0;
+    std::string type, endianness;
+    std::istringstream(list) >> nbImages >> type >> endianness;
+
+    Header header = { 0, 0, 0 };
+    unsigned int depth = 0, spectrum = 0;
+    std::istringstream(size) >> header.width >> header.height >> depth >> spectrum;
+    header.dataOffset = file.tellg();
+
+    if (!file || nbImages != 1 || type != "float" || endianness != "little_endian" || depth != 1 || spectrum != 1
+        || size.find('#') != std::string::npos || header.width == 0 || header.height == 0)
+    {
+        throw CImgIOException("TiledPipeline: '%s' is not an uncompressed single-channel float .cimg file.", filename.c_str());
+    }
+
+    return header;
+}
+
+void TiledPipeline::exec(const std::string& inputFile, const std::string& outputFile) const
+{
+    const Header header = readHeader(inputFile);
+    std::ifstream input(inputFile, std::ios::binary);
+
+    // Output header, pixels are filled tile by tile
+    Header outputHeader = header;
+    {
+        std::ofstream output(outputFile, std::ios::binary | std::ios::trunc);
+        output << "1 float little_endian\n" << header.width << " " << header.height << " 1 1\n";
+        outputHeader.dataOffset = output.tellp();
+    }
+    std::ofstream output(outputFile, std::ios::binary | std::ios::in | std::ios::out);
+
+    unsigned int nbTiles = 0, nbSolved = 0;
+    for (unsigned int y0 = 0 ; y0 < header.height ; y0 += m_tileSize)
+    {
+        for (unsigned int x0 = 0 ; x0 < header.width ; x0 += m_tileSize)
+        {
+            const unsigned int x1 = std::min(x0 + m_tileSize, header.width) - 1;
+            const unsigned int y1 = std::min(y0 + m_tileSize, header.height) - 1;
+
+            // Tile and its halo, clipped to the image
+            const unsigned int haloX0 = x0 > m_halo ? x0 - m_halo : 0;
+            const unsigned int haloY0 = y0 > m_halo ? y0 - m_halo : 0;
+            const unsigned int haloX1 = std::min(x1 + m_halo, header.width - 1);
+            const unsigned int haloY1 = std::min(y1 + m_halo, header.height - 1);
+            CImg<> tile = readTile(input, header, haloX0, haloY0, haloX1, haloY1);
+
+            // Mask pixels of the halo belong to other tiles
+            const int beginX = x0 - haloX0, endX = x1 - haloX0;
+            const int beginY = y0 - haloY0, endY = y1 - haloY0;
+            bool hasMask = false;
+            for (int y = beginY ; y <= endY && !hasMask ; ++y)
+            {
+                for (int x = beginX ; x <= endX && !hasMask ; ++x)
+                    hasMask = (tile(x, y) == 255);
+            }
+
+            if (hasMask)
+            {
+                std::unique_ptr<AbstractAlgorithm> algorithm = m_factory(tile, DefaultSeed + nbTiles);
+                algorithm->exec();
+                tile = algorithm->getResult();
+                ++nbSolved;
+            }
+
+            writeTile(output, outputHeader, x0, y0, tile.get_crop(beginX, beginY, endX, endY));
+            ++nbTiles;
+        }
+
+        if (m_verbose)
+        {
+            std::cout << "Tiles : " << nbTiles << " (" << nbSolved << " solved), rows " << y0 << " to "
+                      << std::min(y0 + m_tileSize, header.height) - 1 << " written" << std::endl;
+        }
+    }
+}
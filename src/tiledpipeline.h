@@ -0,0 +1,88 @@
+#ifndef TILEDPIPELINE_H
+#define TILEDPIPELINE_H
+
+#include "abstractalgorithm.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+
+/**
+ * @brief The TiledPipeline class Streams an image stored in a .cimg file through an algorithm, tile by tile.
+ *
+ * Tiles are read with a halo of context pixels, only the tiles containing mask pixels are solved, and every tile is
+ * written to the output file as soon as it is done. Peak memory is bounded by the tile size, not the image size.
+ * Files hold one single-channel image of floats in little endian order, as written by CImg<float>::save_cimg.
+ */
+class TiledPipeline
+{
+public:
+    /**
+     * @brief Function creating the algorithm solving a tile from its image (halo included) and the seed of its random
+     * generator.
+     */
+    using AlgorithmFactory = std::function<std::unique_ptr<AbstractAlgorithm>(const CImg<>&, unsigned int)>;
+
+    /**
+     * @brief The Header struct Layout of a .cimg file.
+     */
+    struct Header
+    {
+        unsigned int width;     ///< Width of the image.
+        unsigned int height;    ///< Height of the image.
+        long long dataOffset;   ///< Position of the first pixel in the file.
+    };
+
+private:
+    AlgorithmFactory m_factory;     ///< Creation of the algorithm solving a tile.
+    unsigned int m_tileSize;        ///< Width and height of the tiles, halo excluded.
+    unsigned int m_halo;            ///< Number of context pixels read around each tile.
+    bool m_verbose;                 ///< Verbose mode.
+
+public:
+    /**
+     * @brief Constructor
+     * @param factory Creation of the algorithm solving a tile.
+     * @param tileSize Width and height of the tiles, halo excluded.
+     * @param halo Number of context pixels read around each tile.
+     * @param verbose Use verbose mode.
+     */
+    TiledPipeline(AlgorithmFactory factory,
+                  unsigned int tileSize = 1024,
+                  unsigned int halo = 32,
+                  bool verbose = false);
+
+    /**
+     * @brief Read the header of a .cimg file.
+     * @param filename File name.
+     * @return Header. Throws a CImgIOException if the file is not supported.
+     */
+    static Header readHeader(const std::string& filename);
+
+    /**
+     * @brief Process an image file tile by tile.
+     * @param inputFile Input .cimg file, mask pixels having the value 255.
+     * @param outputFile Output .cimg file, created or overwritten.
+     */
+    void exec(const std::string& inputFile, const std::string& outputFile) const;
+
+    /**
+     * @brief Get the tile size.
+     * @return Width and height of the tiles, halo excluded.
+     */
+    unsigned int tileSize() const
+    {
+        return m_tileSize;
+    }
+
+    /**
+     * @brief Get the halo size.
+     * @return Number of context pixels read around each tile.
+     */
+    unsigned int halo() const
+    {
+        return m_halo;
+    }
+};
+
+#endif // TILEDPIPELINE_H